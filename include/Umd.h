@@ -1,8 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <cstring>
 #include <sstream>
 #include "cartridges/Cartridge.h"
 #include "cartridges/Array.h"
@@ -12,6 +14,25 @@
 #include "services/Mcp23008.h"
 #include "services/IGameIdentifier.h"
 #include "services/SdFileGameIdentifier.h"
+#include "services/SdBlockWriter.h"
+#include "services/DumpJournal.h"
+#include "services/BlockMap.h"
+#include "services/PackedDumpWriter.h"
+#include "services/SdTuner.h"
+#include "pipeline/Pipeline.h"
+#include "pipeline/CartridgeSource.h"
+#include "pipeline/ChecksumStage.h"
+#include "pipeline/SdFileSink.h"
+#include "pipeline/PackedFileSink.h"
+#include "pipeline/NullSink.h"
+#include "pipeline/ByteSwapStage.h"
+#include "pipeline/SignatureScanStage.h"
+#include "pipeline/UsbSink.h"
+#include "pipeline/TeeSink.h"
+#include "patch/IByteSource.h"
+#include "patch/IPatchStream.h"
+#include "patch/IpsPatch.h"
+#include "patch/BpsPatch.h"
 
 namespace umd
 {
@@ -23,12 +44,104 @@ namespace umd
     uint32_t OperationTotalTime;
 
     cartridges::Array CartridgeData;
+    // double buffer for writes, one is programmed while the other is filled from the SD card
+    std::array<cartridges::Array, 2> WriteBuffers;
+    // double buffers for each chip of a multi chip board
+    std::array<cartridges::Array, 2 * cartridges::FlashInterleaver::MAX_CHIPS> ChipBuffers;
     File sdFile;
+    // dumps go out in cluster sized multi-block writes, by DMA while the cartridge is being read when possible
+    umd::SdBlockWriter DumpWriter;
+    umd::SdDmaSink SdSink;
+    // progress of the dump in progress, an interrupted dump continues from its last commit
+    umd::DumpJournal Journal;
+    // block checksums written alongside ROM dumps, and read back to check a cartridge against them
+    umd::BlockMap DumpMap;
+    // compression stage of packed dumps
+    umd::PackedDumpWriter Packer;
+
+    // streaming operations are assembled from these stages, the buffers come from the pool
+    pipeline::BufferPool Buffers;
+    pipeline::Pipeline Stream(Buffers);
+    pipeline::CartridgeSource CartSource;
+    // puts the raw captures of 16 bit memories in file order, before the stages that need it
+    pipeline::ByteSwapStage WordSwap;
+    pipeline::ChecksumStage Checksummer;
+    // signatures of the cartridge found in the ROM by the last dump or identify
+    pipeline::SignatureScanStage Scanner;
+    pipeline::SdFileSink FileSink(DumpWriter);
+    pipeline::PackedFileSink PackSink(Packer, DumpWriter);
+    pipeline::NullSink Discard;
+    // a dump can go to the host over USB while it is written to the SD card
+    pipeline::UsbSink UsbOut(SerialUSB);
+    pipeline::TeeSink FileAndUsb(FileSink, UsbOut);
+    // SDIO clock and bus width, measured once per card
+    umd::SdTuner SdTune;
+
+    /// @brief Random access to a file on the SD card for the patchers
+    class FileByteSource : public patch::IByteSource{
+    public:
+        FileByteSource(File& file) : mFile(file) {}
+
+        bool ReadAt(uint32_t offset, uint8_t *buffer, uint32_t size) override {
+            if(mFile.position() != offset && !mFile.seek(offset)){
+                return false;
+            }
+            return (uint32_t)mFile.read(buffer, size) == size;
+        }
+
+    private:
+        File& mFile;
+    };
+
+    /// @brief Read back what was already programmed into the cartridge, for patch copies older than the patcher's
+    /// history. Waits for the flash to be idle since a busy chip returns status bits instead of data.
+    class CartridgeByteSource : public patch::IByteSource{
+    public:
+        CartridgeByteSource(cartridges::Cartridge& cartridge, uint8_t memTypeIndex, cartridges::Array& array)
+            : mCartridge(cartridge), mMemTypeIndex(memTypeIndex), mArray(array) {}
+
+        bool ReadAt(uint32_t offset, uint8_t *buffer, uint32_t size) override {
+            while(mCartridge.IsFlashBusy(mMemTypeIndex));
+            if(mCartridge.GetFlashStatus() != cartridges::FlashProgrammer::Status::IDLE){
+                return false;
+            }
+
+            // the bus is word wide
+            uint32_t address = offset & ~(uint32_t)1;
+            uint32_t skip = offset - address;
+            while(size != 0){
+                uint32_t count = std::min((uint32_t)mArray.Size() - skip, size);
+                mArray.SetTransferSize((skip + count + 1) & ~(uint32_t)1);
+                mCartridge.ReadMemory(address, mArray, mMemTypeIndex, cartridges::Cartridge::ReadOptions::NONE);
+                std::memcpy(buffer, mArray.Data() + skip, count);
+                address += mArray.AvailableSize();
+                buffer += count;
+                size -= count;
+                skip = 0;
+            }
+            return true;
+        }
+
+    private:
+        cartridges::Cartridge& mCartridge;
+        uint8_t mMemTypeIndex;
+        cartridges::Array& mArray;
+    };
 
     namespace Config{
 
         const uint32_t DAS_REPEAT_RATE_MS = 75;
         const uint32_t PROGRESS_REFRESH_RATE_MS = 100;
+        // SD reads are split into slices this size so the flash is polled in between
+        const uint32_t SD_READ_AHEAD_SLICE_BYTES = 64;
+        // verify granularity for chips without a uniform sector size
+        const uint32_t VERIFY_BLOCK_SIZE_BYTES = 0x10000;
+        // journal of the dump in progress, in the system base path
+        const char * const DUMP_JOURNAL_FILE = "dump.jnl";
+        // write a .crc block map alongside ROM dumps
+        const bool DUMP_BLOCK_MAPS = true;
+        // a dump already on the card is only checked against the cartridge instead of being written again
+        const bool SKIP_EXISTING_DUMPS = true;
         const uint8_t MCP23008_BOARD_ADDRESS = 0x27;
         const uint8_t MCP23008_ADAPTER_ADDRESS = 0x20;
 
@@ -57,7 +170,9 @@ namespace umd
         enum UxState : uint8_t{
             UX_MAIN_MENU,
             UX_OPERATION_COMPLETE,
-            UX_SELECT_MEMORY
+            UX_SELECT_MEMORY,
+            UX_SELECT_FILE,
+            UX_SELECT_PATCH
         };
 
         umd::Debouncer Keys = umd::Debouncer(
@@ -79,7 +194,15 @@ namespace umd
             "Identify",
             "Read",
             "Write",
-            "Flash"
+            "Flash",
+            "Patch",
+            "Restore",
+            "Sync",
+            "Safe Read",
+            "Packed Read",
+            "Check",
+            "Compare",
+            "USB Read"
         };
 
         const std::vector<const char *> MENU_WITH_30_ITEMS = {
@@ -101,7 +224,16 @@ namespace umd
             IDLE = -1,
             IDENTIFY,
             READ,
-            WRITE
+            WRITE,
+            FLASH,
+            PATCH,
+            RESTORE,
+            SYNC,
+            SAFE_READ,
+            PACKED_READ,
+            CHECK,
+            COMPARE,
+            USB_READ
         };
 
         std::unique_ptr<cartridges::Cartridge> pCartridge;
@@ -110,55 +242,1315 @@ namespace umd
         CartState State = CartState::IDLE;
         std::string Name = "";
         bool IsIdentified = false;
+        // id of the game in the db, empty if the cartridge isn't in it
+        std::string GameId;
         
         i2cdevice::Mcp23008 IoExpander;
         std::vector<const char *> MemoryNames;
         std::vector<const char *> Metadata;
+        uint8_t SelectedMemoryIndex = 0;
+        std::vector<std::string> FileNames;
+        std::vector<const char *> FileNamesMenu;
+        std::string SelectedFileName;
+        // menu entry of the db block map offered by OfferGameBlockMap()
+        std::string GameBlockMapLabel;
+        uint32_t DeltaSectorsChanged = 0;
+        uint32_t DeltaSectorsTotal = 0;
+        uint32_t SaveBytesWritten = 0;
+
+        // checksum of the last dump, and whether it continued an interrupted one or found it already on the card
+        uint32_t DumpChecksum = 0;
+        bool DumpResumed = false;
+        bool DumpSkipped = false;
+
+        // per block checksums of the data written by ProgramFromFile, and the verify results
+        std::vector<uint32_t> BlockChecksums;
+        uint32_t WrittenChecksum = 0;
+        // bytes after the last whole word of the data written, the checksum calculator only sees whole words
+        std::array<uint8_t, 4> WrittenTail;
+        uint8_t WrittenTailBytes = 0;
+        uint32_t VerifyBadBlocks = 0;
+        uint32_t VerifyFirstBadAddress = 0;
+        uint32_t VerifyLastBadAddress = 0;
+
+        // result of FindMismatch(), a failed read of the file proves nothing either way
+        enum class MismatchResult : uint8_t{
+            MATCH,
+            MISMATCH,
+            FAILED
+        };
+
+        // result of the last compare, the first word that differs and the checksum of the range compared
+        bool CompareMismatch = false;
+        uint32_t CompareAddress = 0;
+        uint16_t CompareCartWord = 0;
+        uint16_t CompareFileWord = 0;
+        uint32_t CompareChecksum = 0;
+
+        // checksum of the source file computed while the flash was erasing, valid if SourceStaged
+        uint32_t SourceChecksum = 0;
+        bool SourceStaged = false;
+        bool SourceMismatch = false;
+
+        // patch applied by ProgramFromFile instead of reading sdFile, and the result of the last patched write
+        patch::IPatchStream* pPatch = nullptr;
+        patch::IPatchStream::Error PatchError = patch::IPatchStream::Error::NONE;
         
         bool Identify(bool updateUi);
-        bool DumpToFile(uint8_t memTypeIndex, const std::string& filename, bool updateUi);
+        bool DumpToFile(uint8_t memTypeIndex, const std::string& filename, bool verified, bool packed, bool usb, bool updateUi);
+        uint32_t ResumeOffset(const std::string& filePath, const umd::DumpJournal::Record& record);
+        bool IsDumpOnCard(uint8_t memTypeIndex, const std::string& filename, uint32_t totalBytes, bool updateUi);
+        bool CheckBlockMap(uint8_t memTypeIndex, const std::string& mapName, bool stopAtFirst, bool updateUi);
+        bool CompareToFile(uint8_t memTypeIndex, const std::string& filename, bool updateUi);
+        MismatchResult FindMismatch(uint8_t memTypeIndex, uint32_t address, uint32_t length);
+        bool WriteFromFile(uint8_t memTypeIndex, const std::string& filename, bool updateUi);
+        bool DeltaWriteFromFile(uint8_t memTypeIndex, const std::string& filename, bool updateUi);
+        bool RestoreSaveFromFile(uint8_t memTypeIndex, const std::string& filename, bool differential, bool updateUi);
+        bool PatchWriteFromFile(uint8_t memTypeIndex, const std::string& romName, const std::string& patchName, bool updateUi);
+        int ReadSource(uint8_t *buffer, uint32_t size);
+        bool StageFromFile(uint8_t memTypeIndex, uint32_t totalBytes);
+        bool ProgramFromFile(uint8_t memTypeIndex, uint32_t address, uint32_t length, uint32_t blockSize, uint32_t totalBytes, bool updateUi, bool primed);
+        bool ProgramInterleavedFromFile(uint8_t memTypeIndex, uint32_t length, uint32_t chipSize, uint32_t blockSize, bool updateUi);
+        bool VerifyBlockChecksums(uint8_t memTypeIndex, uint32_t address, uint32_t length, uint32_t blockSize, bool updateUi);
+        size_t ListFiles(const std::vector<std::string>& extensions);
+        void OfferGameBlockMap(uint8_t memTypeIndex);
 
     }
 }
 
-bool umd::Cart::DumpToFile(uint8_t memTypeIndex, const std::string& filename, bool updateUi = false){
+/// @brief Dump a memory of the cartridge to a file. Progress is committed to the journal every block, a dump
+/// interrupted by a power loss or by pressing Back continues from the last commit the next time the same memory is
+/// dumped to the same file. The checksum of the whole memory is left in DumpChecksum, ROM dumps also get a block map
+/// named like the file with a .crc extension.
+/// @param memTypeIndex memory to read from
+/// @param filename file name in the system base path
+/// @param verified read every block twice with ReadMemoryVerified(), the retries are left in the verify stats and
+/// every retried block is listed in <name>.rty
+/// @param packed compress the dump with the PackedDumpWriter, packed dumps are not journalled and start over
+/// @param usb also stream the dump to the host with the UsbSink, the host gets the whole memory so the dump starts
+/// over, and it stays resumable on the SD card if the host stops reading
+/// @param updateUi show progress, Back stops the dump
+/// @return true if the whole memory was written
+bool umd::Cart::DumpToFile(uint8_t memTypeIndex, const std::string& filename, bool verified, bool packed, bool usb, bool updateUi = false){
     uint32_t currentTicks;
     uint32_t totalBytes;
     uint32_t startTicks;
+    umd::DumpJournal::Record record = {};
+    uint32_t startAddress = 0;
+    bool aborted = false;
+    // the offsets in a packed file don't follow the memory, it can't be resumed
+    bool journalled = !packed;
 
     currentTicks = HAL_GetTick();
     startTicks = currentTicks;
     totalBytes = pCartridge->GetMemorySize(memTypeIndex);
-    CartridgeData.SetTransferSize(totalBytes);
+    DumpChecksum = 0;
+    DumpSkipped = false;
 
     if(updateUi){
         umd::Ux::Display.SetProgressBarVisibility(true);
     }
 
     std::string filePath = umd::Cart::pCartridge->GetSystemBaseFilePath() + filename;
+    std::string journalPath = umd::Cart::pCartridge->GetSystemBaseFilePath() + umd::Config::DUMP_JOURNAL_FILE;
+    std::string mapPath = filePath.substr(0, filePath.find_last_of('.')) + ".crc";
+    // blocks a verified dump had to read again, one "address retries" line each, only created when there is one
+    std::string retryPath = filePath.substr(0, filePath.find_last_of('.')) + ".rty";
+    File retryFile;
+    // save RAM changes all the time, only ROMs are worth a map
+    bool writeMap = umd::Config::DUMP_BLOCK_MAPS && !pCartridge->IsSaveMemory(memTypeIndex);
+
+    // continue an interrupted dump of the same memory to the same file
+    if(journalled && !usb && filename.size() < umd::DumpJournal::MAX_FILE_NAME && Journal.Load(journalPath, record) &&
+        record.MemTypeIndex == memTypeIndex && record.TotalSize == totalBytes && filename == record.FileName &&
+        record.Committed < totalBytes){
+        startAddress = ResumeOffset(filePath, record);
+    }
+    DumpResumed = startAddress != 0;
+
+    // cataloguing a cartridge that was dumped before costs a read, not a read and a write
+    if(!DumpResumed && !packed && !usb && umd::Config::SKIP_EXISTING_DUMPS && IsDumpOnCard(memTypeIndex, filename, totalBytes, updateUi)){
+        DumpSkipped = true;
+        return true;
+    }
+
+    // the retries of the part being resumed are still in the log
+    if(!DumpResumed && verified){
+        SD.remove(retryPath.c_str());
+    }
+
+    if(!DumpResumed){
+        record = {};
+        record.MemTypeIndex = memTypeIndex;
+        record.TotalSize = totalBytes;
+        std::strncpy(record.FileName, filename.c_str(), umd::DumpJournal::MAX_FILE_NAME - 1);
+    }
+
     sdFile = SD.open(filePath.c_str(), FILE_WRITE);
 
     if(!sdFile){
         return false;
     }
 
-    for(int addr = 0; addr < totalBytes; addr += CartridgeData.Size())
+    // the size is known up front, preallocate the file, or carry on in the file of the interrupted dump. A packed
+    // file gets its worst case size, the writer trims the rest
+    if(!DumpWriter.Begin(sdFile, packed ? umd::PackedDumpWriter::MaxFileSize(totalBytes) : totalBytes, &SdSink, startAddress)){
+        sdFile.close();
+        return false;
+    }
+
+    if(packed && !Packer.Begin(DumpWriter, totalBytes)){
+        DumpWriter.Finish();
+        sdFile.close();
+        return false;
+    }
+
+    // the journal of an unrelated dump is replaced
+    if(journalled && (!Journal.Begin(journalPath) || (!DumpResumed && !Journal.Commit(record)))){
+        DumpWriter.Finish();
+        sdFile.close();
+        Journal.End(false);
+        return false;
+    }
+
+    // the map is only a convenience, the dump goes on without it
+    if(writeMap && !DumpMap.Create(mapPath, totalBytes, startAddress / umd::BlockMap::BLOCK_SIZE)){
+        writeMap = false;
+        SD.remove(mapPath.c_str());
+    }
+
+    // cartridge -> file order -> block checksums -> signatures of ROMs -> SD file, or the compressor in front of it,
+    // or the SD file and USB. The checksums are of the file order, as in the db
+    CartSource.Configure(*pCartridge, memTypeIndex, startAddress, totalBytes - startAddress,
+        verified ? pipeline::CartridgeSource::Mode::VERIFIED : pipeline::CartridgeSource::Mode::MEMORY);
+    Checksummer.Configure(*pCartridge, umd::BlockMap::BLOCK_SIZE, totalBytes);
+    Stream.Reset(CartSource);
+    if(CartSource.IsWordSwapped()){
+        Stream.Add(WordSwap);
+    }
+    Stream.Add(Checksummer);
+    if(!pCartridge->IsSaveMemory(memTypeIndex) && Scanner.Configure(pCartridge->GetSignatures())){
+        Stream.Add(Scanner);
+    }
+    if(usb){
+        UsbOut.Configure(filename, totalBytes);
+        Stream.Add(FileAndUsb);
+    }else{
+        Stream.Add(packed ? static_cast<pipeline::Stage&>(PackSink) : static_cast<pipeline::Stage&>(FileSink));
+    }
+
+    // map blocks are checksummed from a reset and combined into the checksum of the journal block
+    uint32_t journalBlockChecksum = 0;
+
+    pCartridge->ResetVerifyStats();
+    bool streaming = Stream.Begin();
+    while(streaming && !Stream.IsDone() && !aborted)
     {
-        umd::Cart::pCartridge->ReadMemory(addr, CartridgeData, memTypeIndex, cartridges::Cartridge::ReadOptions::NONE);
-        sdFile.write(CartridgeData.Data(), CartridgeData.AvailableSize());
+        if(!Stream.Step()){
+            break;
+        }
+
+        pipeline::CartridgeSource::Retry retry;
+        while(verified && CartSource.TakeRetry(retry)){
+            if(!retryFile){
+                retryFile = SD.open(retryPath.c_str(), FILE_WRITE);
+            }
+            if(retryFile){
+                retryFile.printf("%08lX %u\r\n", retry.Address, retry.Retries);
+            }
+        }
+
+        if(!Checksummer.IsBlockReady()){
+            continue;
+        }
+
+        uint32_t end = Checksummer.GetBlockEnd();
+        uint32_t mapBlockChecksum = Checksummer.GetBlockChecksum();
+        journalBlockChecksum = end - Checksummer.GetBlockBytes() == record.Committed ? mapBlockChecksum : pCartridge->CombineChecksums(journalBlockChecksum, mapBlockChecksum, Checksummer.GetBlockBytes() & ~3U);
+
+        // a map that can't be written is dropped rather than left with holes
+        if(writeMap && (!DumpMap.Add(mapBlockChecksum) || ((end % umd::DumpJournal::BLOCK_SIZE) == 0 && !DumpMap.Sync()))){
+            writeMap = false;
+            DumpMap.Close();
+            SD.remove(mapPath.c_str());
+        }
+
+        // commit whole blocks, the checksum of the dump so far is carried in the journal
+        if((end % umd::DumpJournal::BLOCK_SIZE) == 0 || end == totalBytes){
+            uint32_t blockBytes = end - record.Committed;
+            record.LastBlockChecksum = journalBlockChecksum;
+            record.Checksum = record.Committed == 0 ? record.LastBlockChecksum : pCartridge->CombineChecksums(record.Checksum, record.LastBlockChecksum, blockBytes & ~3U);
+            record.Committed = end;
+
+            if(journalled && end != totalBytes && (!DumpWriter.Sync() || !Journal.Commit(record))){
+                break;
+            }
+        }
 
         if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
         {
             currentTicks = HAL_GetTick();
-            umd::Ux::Display.UpdateProgressBar(addr, totalBytes);
+            umd::Ux::Display.UpdateProgressBar(end, totalBytes);
             umd::Ux::Display.Redraw();
+
+            // the journal keeps the dump for later
+            umd::Ux::Keys.Process(umd::IoExpander.readGPIO(), currentTicks);
+            aborted = umd::Ux::Keys.Back >= Key::Pressed;
         }
     }
 
+    // the sinks finish the writers
+    bool result = Stream.Finish() && record.Committed == totalBytes;
+    if(packed && result){
+        result = Packer.Finish(sdFile, record.Checksum);
+    }
     sdFile.close();
+    if(retryFile){
+        retryFile.close();
+    }
+    if(writeMap && result){
+        DumpMap.Finish(record.Checksum);
+    }else{
+        DumpMap.Close();
+    }
+    if(journalled){
+        Journal.End(result);
+    }
+    if(usb){
+        UsbOut.SendResult(result, record.Checksum);
+    }
+
+    if(result){
+        DumpChecksum = record.Checksum;
+    }
+    return result;
+}
+
+/// @brief Check whether a dump of the memory is already on the card, from its block map when there is a complete one
+/// or else from the file itself. Either way the cartridge is read and the check stops at the first difference.
+/// @param memTypeIndex memory to dump
+/// @param filename file name of the dump in the system base path
+/// @param totalBytes size of the memory
+/// @param updateUi show progress
+/// @return true if the file matches the cartridge, its checksum is left in DumpChecksum
+bool umd::Cart::IsDumpOnCard(uint8_t memTypeIndex, const std::string& filename, uint32_t totalBytes, bool updateUi){
+    std::string basePath = pCartridge->GetSystemBaseFilePath();
+
+    File file = SD.open((basePath + filename).c_str(), FILE_READ);
+    if(!file){
+        return false;
+    }
+    uint32_t fileSize = file.size();
+    file.close();
+    if(fileSize != totalBytes){
+        return false;
+    }
+
+    // only ROM dumps have a map, it is complete once it has the checksum of the whole dump
+    std::string mapName = filename.substr(0, filename.find_last_of('.')) + ".crc";
+    if(!pCartridge->IsSaveMemory(memTypeIndex) && DumpMap.Open(basePath + mapName)){
+        umd::BlockMap::Header header = DumpMap.GetHeader();
+        DumpMap.Close();
+        if(header.TotalSize == totalBytes && header.Checksum != 0){
+            if(!CheckBlockMap(memTypeIndex, mapName, true, updateUi)){
+                return false;
+            }
+            DumpChecksum = header.Checksum;
+            return true;
+        }
+    }
+
+    if(!CompareToFile(memTypeIndex, filename, updateUi)){
+        return false;
+    }
+    DumpChecksum = CompareChecksum;
     return true;
 }
 
+/// @brief Check the file of an interrupted dump against its journal, the last committed block is read back since
+/// the card may have lost data it acknowledged. The same block is then read from the cartridge, a different
+/// cartridge of the same size would otherwise be appended to the dump of the first
+/// @param filePath path of the dump
+/// @param record journal of the interrupted dump
+/// @return offset to continue the dump from, 0 to start over
+uint32_t umd::Cart::ResumeOffset(const std::string& filePath, const umd::DumpJournal::Record& record){
+    const uint32_t blockSize = umd::DumpJournal::BLOCK_SIZE;
+
+    if(record.Committed < blockSize || (record.Committed % blockSize) != 0){
+        return 0;
+    }
+
+    File file = SD.open(filePath.c_str(), FILE_READ);
+    if(!file){
+        return 0;
+    }
+
+    bool match = file.size() >= record.Committed && file.seek(record.Committed - blockSize);
+    pCartridge->ResetChecksumCalculator();
+    for(uint32_t offset = 0; match && offset < blockSize; offset += CartridgeData.AvailableSize())
+    {
+        int bytesRead = file.read(CartridgeData.Data(), std::min((uint32_t)CartridgeData.Size(), blockSize - offset));
+        if(bytesRead <= 0){
+            match = false;
+            break;
+        }
+        CartridgeData.SetAvailableSize(bytesRead);
+        pCartridge->AccumulateChecksum(CartridgeData);
+    }
+    file.close();
+
+    if(!match || pCartridge->GetAccumulatedChecksum() != record.LastBlockChecksum){
+        return 0;
+    }
+
+    CartridgeData.SetTransferSize(blockSize);
+    pCartridge->ResetChecksumCalculator();
+    for(uint32_t addr = record.Committed - blockSize; addr < record.Committed; addr += CartridgeData.Size())
+    {
+        pCartridge->ReadMemory(addr, CartridgeData, record.MemTypeIndex, cartridges::Cartridge::ReadOptions::NONE);
+        pCartridge->AccumulateChecksum(CartridgeData);
+    }
+
+    if(pCartridge->GetAccumulatedChecksum() != record.LastBlockChecksum){
+        return 0;
+    }
+    return record.Committed;
+}
+
+/// @brief Use the time the flash spends erasing to prepare the image: checksum the whole file into SourceChecksum,
+/// then rewind it and load the first write buffer so programming can start as soon as the erase completes.
+/// The checksum is abandoned if the erase completes first.
+/// @param memTypeIndex memory being erased
+/// @param totalBytes size of the file
+/// @return true if the first write buffer was loaded
+bool umd::Cart::StageFromFile(uint8_t memTypeIndex, uint32_t totalBytes){
+    uint32_t staged = 0;
+
+    pCartridge->ResetChecksumCalculator();
+    while(staged < totalBytes && pCartridge->IsFlashBusy(memTypeIndex))
+    {
+        int bytesRead = sdFile.read(CartridgeData.Data(), std::min((uint32_t)CartridgeData.Size(), totalBytes - staged));
+        if(bytesRead <= 0){
+            return false;
+        }
+        CartridgeData.SetAvailableSize(bytesRead);
+        pCartridge->AccumulateChecksum(CartridgeData);
+        staged += bytesRead;
+    }
+
+    SourceStaged = staged == totalBytes;
+    SourceChecksum = pCartridge->GetAccumulatedChecksum();
+
+    // rewind and load the first buffer
+    sdFile.seek(0);
+    uint32_t chunkSize = std::min((uint32_t)WriteBuffers[0].Size(), totalBytes);
+    if((uint32_t)sdFile.read(WriteBuffers[0].Data(), chunkSize) != chunkSize){
+        return false;
+    }
+    WriteBuffers[0].SetAvailableSize(chunkSize);
+    return true;
+}
+
+/// @brief Read the next bytes of the data to program, from the patch being applied or else from sdFile
+/// @return number of bytes read, 0 or less on an error
+int umd::Cart::ReadSource(uint8_t *buffer, uint32_t size){
+    if(pPatch != nullptr){
+        return (int)pPatch->Read(buffer, size);
+    }
+    return sdFile.read(buffer, size);
+}
+
+/// @brief Program a range of the cartridge from the current position of sdFile, or from pPatch when a patch is being
+/// applied. The next chunk is read from the
+/// SD card while the previous one is being programmed, the SD reads are sliced so the flash status is polled in between.
+/// The checksum of every block of source data is accumulated into BlockChecksums for VerifyBlockChecksums().
+/// @param memTypeIndex memory to write to
+/// @param address start address of the range
+/// @param length number of bytes to program
+/// @param blockSize size of the blocks to checksum, multiple of the buffer size
+/// @param totalBytes size of the whole operation, for the progress bar
+/// @param updateUi show progress and throughput, measured from OperationStartTime
+/// @param primed the first write buffer was already loaded by StageFromFile()
+/// @return true on success
+bool umd::Cart::ProgramFromFile(uint8_t memTypeIndex, uint32_t address, uint32_t length, uint32_t blockSize, uint32_t totalBytes, bool updateUi, bool primed){
+    uint32_t currentTicks = HAL_GetTick();
+    uint32_t endAddress = address + length;
+
+    BlockChecksums.clear();
+    WrittenTailBytes = 0;
+    pCartridge->ResetChecksumCalculator();
+
+    // prime the first buffer
+    uint8_t current = 0;
+    uint32_t chunkSize = std::min((uint32_t)WriteBuffers[current].Size(), length);
+    if(!primed){
+        if((uint32_t)ReadSource(WriteBuffers[current].Data(), chunkSize) != chunkSize){
+            return false;
+        }
+        WriteBuffers[current].SetAvailableSize(chunkSize);
+    }
+
+    for(uint32_t addr = address; addr < endAddress; addr += chunkSize)
+    {
+        chunkSize = WriteBuffers[current].AvailableSize();
+        if(pCartridge->BeginProgramFlash(addr, WriteBuffers[current].Data(), chunkSize, memTypeIndex) != 0){
+            return false;
+        }
+
+        // checksum the source while the flash is busy
+        pCartridge->AccumulateChecksum(WriteBuffers[current]);
+        if(((addr + chunkSize - address) % blockSize) == 0 || (addr + chunkSize) >= endAddress){
+            BlockChecksums.push_back(pCartridge->GetAccumulatedChecksum());
+            pCartridge->ResetChecksumCalculator();
+        }
+        if((addr + chunkSize) >= endAddress){
+            WrittenTailBytes = chunkSize % 4;
+            std::memcpy(WrittenTail.data(), WriteBuffers[current].Data() + chunkSize - WrittenTailBytes, WrittenTailBytes);
+        }
+
+        // read ahead into the other buffer while the flash is busy
+        uint8_t next = current ^ 1;
+        uint32_t nextSize = std::min((uint32_t)WriteBuffers[next].Size(), endAddress - (addr + chunkSize));
+        uint32_t nextFilled = 0;
+        bool readError = false;
+
+        while(pCartridge->IsFlashBusy(memTypeIndex) || (nextFilled < nextSize && !readError))
+        {
+            if(nextFilled < nextSize && !readError){
+                uint32_t slice = std::min(umd::Config::SD_READ_AHEAD_SLICE_BYTES, nextSize - nextFilled);
+                int bytesRead = ReadSource(WriteBuffers[next].Data() + nextFilled, slice);
+                if(bytesRead <= 0){
+                    readError = true;
+                }else{
+                    nextFilled += bytesRead;
+                }
+            }
+        }
+
+        if(readError || pCartridge->GetFlashStatus() != cartridges::FlashProgrammer::Status::IDLE){
+            return false;
+        }
+
+        WriteBuffers[next].SetAvailableSize(nextSize);
+        current = next;
+
+        if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
+        {
+            currentTicks = HAL_GetTick();
+            uint32_t elapsed = currentTicks - OperationStartTime;
+            uint32_t written = addr + chunkSize;
+            umd::Ux::Display.UpdateProgressBarRate(written, totalBytes, elapsed == 0 ? 0 : (uint32_t)(((uint64_t)written * 1000) / elapsed));
+            umd::Ux::Display.Redraw();
+        }
+    }
+
+    return true;
+}
+
+/// @brief Program a file across the chips of a multi chip board at the same time. Each chip has two buffers, one is
+/// programmed while the other is filled from the chip's part of the file, and a chip gets its next buffer as soon as
+/// it is idle. The checksums of the chunks are combined per block so BlockChecksums stays in address order.
+/// @param memTypeIndex memory to write to
+/// @param length number of bytes to program from the start of the file
+/// @param chipSize size of one chip in bytes
+/// @param blockSize size of the blocks to checksum, must divide the chip size
+/// @param updateUi show progress and throughput, measured from OperationStartTime
+/// @return true on success
+bool umd::Cart::ProgramInterleavedFromFile(uint8_t memTypeIndex, uint32_t length, uint32_t chipSize, uint32_t blockSize, bool updateUi){
+    const uint8_t NO_CHIP = cartridges::FlashInterleaver::MAX_CHIPS;
+    const uint8_t chips = std::min(pCartridge->GetFlashChipCount(), NO_CHIP);
+    uint32_t currentTicks = HAL_GetTick();
+
+    uint32_t chipEnd[NO_CHIP], issued[NO_CHIP], loaded[NO_CHIP], blockChecksum[NO_CHIP], blockFilled[NO_CHIP];
+    uint8_t current[NO_CHIP];
+    bool inFlight[NO_CHIP], ready[NO_CHIP];
+    uint8_t reading = NO_CHIP;
+    uint32_t filled = 0;
+    uint32_t written = 0;
+
+    BlockChecksums.assign((length + blockSize - 1) / blockSize, 0);
+    WrittenTailBytes = 0;
+    for(uint8_t c = 0; c < chips; c++){
+        uint32_t chipStart = c * chipSize;
+        chipEnd[c] = chipStart < length ? std::min(chipSize, length - chipStart) : 0;
+        issued[c] = loaded[c] = blockChecksum[c] = blockFilled[c] = 0;
+        current[c] = 0;
+        inFlight[c] = ready[c] = false;
+    }
+
+    while(true)
+    {
+        // advance every chip
+        pCartridge->IsFlashBusy(memTypeIndex);
+        cartridges::FlashProgrammer::Status status = pCartridge->GetFlashStatus();
+        if(status != cartridges::FlashProgrammer::Status::IDLE && status != cartridges::FlashProgrammer::Status::BUSY){
+            return false;
+        }
+
+        // give the idle chips their next buffer
+        bool done = true;
+        for(uint8_t c = 0; c < chips; c++){
+            if(inFlight[c] && pCartridge->GetFlashChipStatus(c) != cartridges::FlashProgrammer::Status::BUSY){
+                inFlight[c] = false;
+            }
+
+            if(!inFlight[c] && ready[c]){
+                current[c] ^= 1;
+                cartridges::Array& buffer = ChipBuffers[(c << 1) + current[c]];
+                uint32_t size = buffer.AvailableSize();
+                uint32_t addr = c * chipSize + issued[c];
+
+                if(pCartridge->BeginProgramFlash(addr, buffer.Data(), size, memTypeIndex) != 0){
+                    return false;
+                }
+                inFlight[c] = pCartridge->GetFlashChipStatus(c) == cartridges::FlashProgrammer::Status::BUSY;
+                ready[c] = false;
+
+                // checksum the chunk while the chip is busy
+                pCartridge->ResetChecksumCalculator();
+                pCartridge->AccumulateChecksum(buffer);
+                uint32_t chunkChecksum = pCartridge->GetAccumulatedChecksum();
+                blockChecksum[c] = blockFilled[c] == 0 ? chunkChecksum : pCartridge->CombineChecksums(blockChecksum[c], chunkChecksum, size & ~3U);
+                blockFilled[c] += size;
+                issued[c] += size;
+                written += size;
+
+                if(blockFilled[c] == blockSize || issued[c] == chipEnd[c]){
+                    BlockChecksums[(addr + size - blockFilled[c]) / blockSize] = blockChecksum[c];
+                    blockFilled[c] = 0;
+                }
+                if(addr + size == length){
+                    WrittenTailBytes = size % 4;
+                    std::memcpy(WrittenTail.data(), buffer.Data() + size - WrittenTailBytes, WrittenTailBytes);
+                }
+            }
+
+            if(issued[c] < chipEnd[c] || inFlight[c]){
+                done = false;
+            }
+        }
+
+        if(done){
+            break;
+        }
+
+        // fill the next buffer of one chip, an idle chip goes first. A buffer is filled completely before moving to
+        // another chip since that needs a seek.
+        if(reading == NO_CHIP){
+            for(uint8_t c = 0; c < chips; c++){
+                if(!ready[c] && loaded[c] < chipEnd[c] && (reading == NO_CHIP || !inFlight[c])){
+                    reading = c;
+                }
+            }
+            if(reading != NO_CHIP){
+                sdFile.seek(reading * chipSize + loaded[reading]);
+                filled = 0;
+            }
+        }
+
+        if(reading != NO_CHIP){
+            cartridges::Array& next = ChipBuffers[(reading << 1) + (current[reading] ^ 1)];
+            uint32_t nextSize = std::min((uint32_t)next.Size(), chipEnd[reading] - loaded[reading]);
+            uint32_t slice = std::min(umd::Config::SD_READ_AHEAD_SLICE_BYTES, nextSize - filled);
+            int bytesRead = sdFile.read(next.Data() + filled, slice);
+            if(bytesRead <= 0){
+                return false;
+            }
+            filled += bytesRead;
+
+            if(filled == nextSize){
+                next.SetAvailableSize(nextSize);
+                loaded[reading] += nextSize;
+                ready[reading] = true;
+                reading = NO_CHIP;
+            }
+        }
+
+        if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
+        {
+            currentTicks = HAL_GetTick();
+            uint32_t elapsed = currentTicks - OperationStartTime;
+            umd::Ux::Display.UpdateProgressBarRate(written, length, elapsed == 0 ? 0 : (uint32_t)(((uint64_t)written * 1000) / elapsed));
+            umd::Ux::Display.Redraw();
+        }
+    }
+
+    return true;
+}
+
+/// @brief Read back a range of the cartridge and compare it with the BlockChecksums of the data that was written.
+/// A single read pass checksums every block, the whole digests are combined from the block checksums so finding
+/// the bad blocks on a mismatch doesn't need another read. The bytes after the last whole word, which the checksums
+/// don't cover, are compared with WrittenTail.
+/// @param memTypeIndex memory to verify
+/// @param address start address of the range
+/// @param length number of bytes to verify
+/// @param blockSize size of the blocks in BlockChecksums
+/// @param updateUi show progress
+/// @return true if no block is bad
+bool umd::Cart::VerifyBlockChecksums(uint8_t memTypeIndex, uint32_t address, uint32_t length, uint32_t blockSize, bool updateUi){
+    uint32_t currentTicks = HAL_GetTick();
+    uint32_t endAddress = address + length;
+    uint32_t block = 0;
+
+    WrittenChecksum = 0;
+    VerifyBadBlocks = 0;
+    VerifyFirstBadAddress = 0;
+
+    for(uint32_t blockAddress = address; blockAddress < endAddress; blockAddress += blockSize, block++)
+    {
+        uint32_t blockBytes = std::min(blockSize, endAddress - blockAddress);
+
+        if(block >= BlockChecksums.size()){
+            return false;
+        }
+
+        pCartridge->ResetChecksumCalculator();
+        CartridgeData.SetTransferSize(blockBytes);
+        for(uint32_t addr = blockAddress; addr < blockAddress + blockBytes; addr += CartridgeData.Size()){
+            pCartridge->ReadMemory(addr, CartridgeData, memTypeIndex, cartridges::Cartridge::ReadOptions::CHECKSUM_CALCULATOR);
+        }
+        uint32_t blockChecksum = pCartridge->GetAccumulatedChecksum();
+
+        // the last read holds the end of the range
+        bool tailMatches = true;
+        if(blockAddress + blockBytes == endAddress && WrittenTailBytes != 0){
+            tailMatches = std::memcmp(CartridgeData.Data() + CartridgeData.AvailableSize() - WrittenTailBytes, WrittenTail.data(), WrittenTailBytes) == 0;
+        }
+
+        if(block == 0){
+            WrittenChecksum = BlockChecksums[block];
+        }else{
+            // the block checksum covers whole words only, like the continuous SourceChecksum
+            WrittenChecksum = pCartridge->CombineChecksums(WrittenChecksum, BlockChecksums[block], blockBytes & ~3U);
+        }
+
+        if(blockChecksum != BlockChecksums[block] || !tailMatches){
+            if(VerifyBadBlocks == 0){
+                VerifyFirstBadAddress = blockAddress;
+            }
+            VerifyBadBlocks++;
+        }
+
+        if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
+        {
+            currentTicks = HAL_GetTick();
+            umd::Ux::Display.UpdateProgressBar(blockAddress + blockBytes - address, length);
+            umd::Ux::Display.Redraw();
+        }
+    }
+
+    return VerifyBadBlocks == 0;
+}
+
+/// @brief Check a memory of the cartridge against a block map, from a dump or from the database. Every block is read
+/// and checksummed, the blocks that differ are counted in VerifyBadBlocks and the range they span is left in
+/// VerifyFirstBadAddress and VerifyLastBadAddress.
+/// @param memTypeIndex memory to check
+/// @param mapName file name of the map in the system base path
+/// @param stopAtFirst stop at the first block that differs
+/// @param updateUi show progress
+/// @return true if every block matches
+bool umd::Cart::CheckBlockMap(uint8_t memTypeIndex, const std::string& mapName, bool stopAtFirst, bool updateUi = false){
+    uint32_t currentTicks = HAL_GetTick();
+    const uint32_t blockSize = umd::BlockMap::BLOCK_SIZE;
+
+    VerifyBadBlocks = 0;
+    VerifyFirstBadAddress = 0;
+    VerifyLastBadAddress = 0;
+
+    if(!DumpMap.Open(pCartridge->GetSystemBaseFilePath() + mapName)){
+        return false;
+    }
+
+    // a map of a larger memory can't match
+    uint32_t totalBytes = DumpMap.GetHeader().TotalSize;
+    if(totalBytes == 0 || totalBytes > pCartridge->GetMemorySize(memTypeIndex)){
+        DumpMap.Close();
+        return false;
+    }
+
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarVisibility(true);
+    }
+
+    bool result = true;
+    CartridgeData.SetTransferSize(totalBytes);
+    for(uint32_t blockAddress = 0, block = 0; blockAddress < totalBytes; blockAddress += blockSize, block++)
+    {
+        uint32_t blockEnd = std::min(blockAddress + blockSize, totalBytes);
+        uint32_t expected;
+        if(!DumpMap.Get(block, expected)){
+            result = false;
+            break;
+        }
+
+        pCartridge->ResetChecksumCalculator();
+        for(uint32_t addr = blockAddress; addr < blockEnd; addr += CartridgeData.Size()){
+            pCartridge->ReadMemory(addr, CartridgeData, memTypeIndex, cartridges::Cartridge::ReadOptions::CHECKSUM_CALCULATOR);
+        }
+
+        if(pCartridge->GetAccumulatedChecksum() != expected){
+            if(VerifyBadBlocks == 0){
+                VerifyFirstBadAddress = blockAddress;
+            }
+            VerifyLastBadAddress = blockEnd - 1;
+            VerifyBadBlocks++;
+            result = false;
+            if(stopAtFirst){
+                break;
+            }
+        }
+
+        if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
+        {
+            currentTicks = HAL_GetTick();
+            umd::Ux::Display.UpdateProgressBar(blockEnd, totalBytes);
+            umd::Ux::Display.Redraw();
+        }
+    }
+
+    DumpMap.Close();
+    return result;
+}
+
+/// @brief Compare a memory of the cartridge with a file on the SD card, nothing is written. Both are checksummed block
+/// by block, a block whose checksums differ is read again word by word to find the first difference, which ends the
+/// compare. The file may be smaller than the memory, i.e. a ROM on a larger flash cart.
+/// @param memTypeIndex memory to compare
+/// @param filename file name in the system base path
+/// @param updateUi show progress
+/// @return true if the memory matches the whole file, the checksum of the file is left in CompareChecksum
+bool umd::Cart::CompareToFile(uint8_t memTypeIndex, const std::string& filename, bool updateUi = false){
+    uint32_t currentTicks = HAL_GetTick();
+    const uint32_t blockSize = umd::BlockMap::BLOCK_SIZE;
+
+    CompareMismatch = false;
+    CompareAddress = 0;
+    CompareChecksum = 0;
+
+    std::string filePath = umd::Cart::pCartridge->GetSystemBaseFilePath() + filename;
+    sdFile = SD.open(filePath.c_str(), FILE_READ);
+    if(!sdFile){
+        return false;
+    }
+
+    uint32_t totalBytes = sdFile.size();
+    if(totalBytes == 0 || totalBytes > pCartridge->GetMemorySize(memTypeIndex)){
+        sdFile.close();
+        return false;
+    }
+
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarVisibility(true);
+    }
+
+    bool result = true;
+    for(uint32_t blockAddress = 0; blockAddress < totalBytes; blockAddress += blockSize)
+    {
+        uint32_t blockBytes = std::min(blockSize, totalBytes - blockAddress);
+
+        // the checksum unit is shared, the file block goes first
+        pCartridge->ResetChecksumCalculator();
+        for(uint32_t offset = 0; offset < blockBytes; offset += CartridgeData.AvailableSize()){
+            int bytesRead = sdFile.read(CartridgeData.Data(), std::min((uint32_t)CartridgeData.Size(), blockBytes - offset));
+            if(bytesRead <= 0){
+                sdFile.close();
+                return false;
+            }
+            CartridgeData.SetAvailableSize(bytesRead);
+            pCartridge->AccumulateChecksum(CartridgeData);
+        }
+        uint32_t fileChecksum = pCartridge->GetAccumulatedChecksum();
+
+        pCartridge->ResetChecksumCalculator();
+        CartridgeData.SetTransferSize(blockBytes);
+        for(uint32_t addr = blockAddress; addr < blockAddress + blockBytes; addr += CartridgeData.Size()){
+            pCartridge->ReadMemory(addr, CartridgeData, memTypeIndex, cartridges::Cartridge::ReadOptions::CHECKSUM_CALCULATOR);
+        }
+
+        // the checksums only cover whole 32 bit words, an odd sized last block is always compared word by word
+        if(pCartridge->GetAccumulatedChecksum() != fileChecksum || (blockBytes % 4) != 0){
+            result = false;
+            if(!sdFile.seek(blockAddress) || FindMismatch(memTypeIndex, blockAddress, blockBytes) != MismatchResult::MATCH){
+                break;
+            }
+            result = true;
+        }
+        CompareChecksum = blockAddress == 0 ? fileChecksum : pCartridge->CombineChecksums(CompareChecksum, fileChecksum, blockBytes & ~3U);
+
+        if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
+        {
+            currentTicks = HAL_GetTick();
+            umd::Ux::Display.UpdateProgressBar(blockAddress + blockBytes, totalBytes);
+            umd::Ux::Display.Redraw();
+        }
+    }
+
+    sdFile.close();
+    return result;
+}
+
+/// @brief Compare a range of the cartridge with sdFile from its current position word by word, after the
+/// checksums of the range differed
+/// @param memTypeIndex memory to compare
+/// @param address start address of the range
+/// @param length number of bytes to compare
+/// @return MISMATCH if a difference was found, it is left in CompareAddress, CompareCartWord and CompareFileWord,
+/// FAILED if the file couldn't be read
+umd::Cart::MismatchResult umd::Cart::FindMismatch(uint8_t memTypeIndex, uint32_t address, uint32_t length){
+    cartridges::Array& fileData = WriteBuffers[0];
+
+    CartridgeData.SetTransferSize(length);
+    for(uint32_t addr = address; addr < address + length; addr += CartridgeData.Size())
+    {
+        pCartridge->ReadMemory(addr, CartridgeData, memTypeIndex, cartridges::Cartridge::ReadOptions::NONE);
+        uint32_t size = CartridgeData.AvailableSize();
+        if((uint32_t)sdFile.read(fileData.Data(), size) != size){
+            return MismatchResult::FAILED;
+        }
+
+        for(uint32_t i = 0; i < size; i += 2){
+            if(CartridgeData[i] != fileData[i] || (i + 1 < size && CartridgeData[i + 1] != fileData[i + 1])){
+                CompareMismatch = true;
+                CompareAddress = addr + i;
+                CompareCartWord = (uint16_t)((CartridgeData[i] << 8) | (i + 1 < size ? CartridgeData[i + 1] : 0));
+                CompareFileWord = (uint16_t)((fileData[i] << 8) | (i + 1 < size ? fileData[i + 1] : 0));
+                return MismatchResult::MISMATCH;
+            }
+        }
+    }
+    return MismatchResult::MATCH;
+}
+
+/// @brief Write a file from the SD card to the cartridge, the sectors covered by the file are erased first
+/// @param memTypeIndex memory to write to
+/// @param filename file name in the system base path
+/// @param updateUi show progress and throughput
+/// @return true on success
+bool umd::Cart::WriteFromFile(uint8_t memTypeIndex, const std::string& filename, bool updateUi = false){
+    uint32_t totalBytes;
+
+    VerifyBadBlocks = 0;
+    SourceStaged = false;
+    SourceMismatch = false;
+
+    std::string filePath = umd::Cart::pCartridge->GetSystemBaseFilePath() + filename;
+    sdFile = SD.open(filePath.c_str(), FILE_READ);
+
+    if(!sdFile){
+        return false;
+    }
+
+    cartridges::FlashInfo info = pCartridge->GetFlashInfo(memTypeIndex);
+    totalBytes = sdFile.size();
+    if(totalBytes == 0 || totalBytes > info.Size){
+        sdFile.close();
+        return false;
+    }
+
+    // erase the sectors covered by the file and wait for it
+    if(updateUi){
+        if(info.HasGeometry()){
+            umd::Ux::Display.Printf(F("Est  : %lus"), (info.EstimateEraseMs(0, totalBytes) + info.EstimateProgramMs(totalBytes)) / 1000);
+        }
+        umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("erasing..."));
+        umd::Ux::Display.Redraw();
+    }
+    if(pCartridge->EraseFlashRange(0, totalBytes, memTypeIndex) != 0){
+        sdFile.close();
+        return false;
+    }
+    bool primed = StageFromFile(memTypeIndex, totalBytes);
+    if(!primed){
+        sdFile.seek(0);
+    }
+    while(pCartridge->IsFlashBusy(memTypeIndex));
+
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarVisibility(true);
+    }
+
+    OperationStartTime = HAL_GetTick();
+    uint32_t blockSize = info.SectorSize;
+    if(blockSize == 0){
+        blockSize = umd::Config::VERIFY_BLOCK_SIZE_BYTES;
+    }
+    bool interleave = pCartridge->GetFlashChipCount() > 1 && totalBytes > info.Chip.Size;
+    bool result = pCartridge->GetFlashStatus() == cartridges::FlashProgrammer::Status::IDLE
+        && (interleave ? ProgramInterleavedFromFile(memTypeIndex, totalBytes, info.Chip.Size, blockSize, updateUi)
+                       : ProgramFromFile(memTypeIndex, 0, totalBytes, blockSize, totalBytes, updateUi, primed));
+    sdFile.close();
+
+    if(result){
+        if(updateUi){
+            umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("verifying..."));
+        }
+        result = VerifyBlockChecksums(memTypeIndex, 0, totalBytes, blockSize, updateUi);
+    }
+
+    // the data programmed must match the file as it was read during the erase
+    SourceMismatch = result && SourceStaged && SourceChecksum != WrittenChecksum;
+    if(SourceMismatch){
+        result = false;
+    }
+
+    OperationTotalTime = HAL_GetTick() - OperationStartTime;
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarComplete(OperationTotalTime);
+    }
+
+    return result;
+}
+
+/// @brief Write a base ROM from the SD card with an IPS or BPS patch applied on the fly, the patched image is never
+/// stored. The patch is checked against the source while the flash is erasing, then the patched data is programmed
+/// as it is produced and its CRC checked against the one stored in the patch.
+/// @param memTypeIndex memory to write to
+/// @param romName base ROM file name in the system base path
+/// @param patchName patch file name in the system base path, the format is chosen by the .bps or .ips extension
+/// @param updateUi show progress and throughput
+/// @return true on success, PatchError tells why the patch couldn't be applied
+bool umd::Cart::PatchWriteFromFile(uint8_t memTypeIndex, const std::string& romName, const std::string& patchName, bool updateUi = false){
+    VerifyBadBlocks = 0;
+    SourceStaged = false;
+    SourceMismatch = false;
+    PatchError = patch::IPatchStream::Error::NONE;
+
+    std::string basePath = umd::Cart::pCartridge->GetSystemBaseFilePath();
+    sdFile = SD.open((basePath + romName).c_str(), FILE_READ);
+    if(!sdFile){
+        return false;
+    }
+    File patchFile = SD.open((basePath + patchName).c_str(), FILE_READ);
+    if(!patchFile){
+        sdFile.close();
+        return false;
+    }
+
+    FileByteSource source(sdFile);
+    FileByteSource patchSource(patchFile);
+    CartridgeByteSource target(*pCartridge, memTypeIndex, CartridgeData);
+    std::unique_ptr<patch::IPatchStream> pStream;
+    const std::string bps = ".bps";
+    if(patchName.size() > bps.size() && patchName.compare(patchName.size() - bps.size(), bps.size(), bps) == 0){
+        pStream = std::make_unique<patch::BpsPatch>(source, sdFile.size(), patchSource, patchFile.size(), &target);
+    }else{
+        pStream = std::make_unique<patch::IpsPatch>(source, sdFile.size(), patchSource, patchFile.size());
+    }
+
+    cartridges::FlashInfo info = pCartridge->GetFlashInfo(memTypeIndex);
+    bool result = pStream->Begin();
+    uint32_t totalBytes = pStream->GetTargetSize();
+    result = result && totalBytes != 0 && totalBytes <= info.Size;
+
+    // erase the sectors covered by the patched image, the source and the patch are checked meanwhile
+    if(result){
+        if(updateUi){
+            if(info.HasGeometry()){
+                umd::Ux::Display.Printf(F("Est  : %lus"), (info.EstimateEraseMs(0, totalBytes) + info.EstimateProgramMs(totalBytes)) / 1000);
+            }
+            umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("erasing..."));
+            umd::Ux::Display.Redraw();
+        }
+        result = pCartridge->EraseFlashRange(0, totalBytes, memTypeIndex) == 0;
+    }
+    if(result){
+        result = pStream->Validate();
+        while(pCartridge->IsFlashBusy(memTypeIndex));
+        result = result && pCartridge->GetFlashStatus() == cartridges::FlashProgrammer::Status::IDLE;
+    }
+
+    uint32_t blockSize = info.SectorSize;
+    if(blockSize == 0){
+        blockSize = umd::Config::VERIFY_BLOCK_SIZE_BYTES;
+    }
+
+    OperationStartTime = HAL_GetTick();
+    if(result){
+        if(updateUi){
+            umd::Ux::Display.SetProgressBarVisibility(true);
+        }
+        pPatch = pStream.get();
+        result = ProgramFromFile(memTypeIndex, 0, totalBytes, blockSize, totalBytes, updateUi, false);
+        pPatch = nullptr;
+        result = result && pStream->Finish();
+    }
+
+    PatchError = pStream->GetError();
+    patchFile.close();
+    sdFile.close();
+
+    if(result){
+        if(updateUi){
+            umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("verifying..."));
+        }
+        result = VerifyBlockChecksums(memTypeIndex, 0, totalBytes, blockSize, updateUi);
+    }
+
+    OperationTotalTime = HAL_GetTick() - OperationStartTime;
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarComplete(OperationTotalTime);
+    }
+
+    return result;
+}
+
+/// @brief Write a save file from the SD card back to the save RAM of the cartridge. In differential mode each block
+/// of the cartridge is read and compared with the file first and only the runs of bytes that differ are written, so
+/// a save that is already in sync costs a single read pass on the battery backed chip.
+/// @param memTypeIndex save memory to write to
+/// @param filename file name in the system base path, must be the size of the save memory
+/// @param differential only write the bytes that differ
+/// @param updateUi show progress
+/// @return true on success, SaveBytesWritten counts the bytes written
+bool umd::Cart::RestoreSaveFromFile(uint8_t memTypeIndex, const std::string& filename, bool differential, bool updateUi = false){
+    uint32_t currentTicks = HAL_GetTick();
+    uint32_t totalBytes = pCartridge->GetMemorySize(memTypeIndex);
+
+    SaveBytesWritten = 0;
+    if(totalBytes == 0){
+        return false;
+    }
+
+    std::string filePath = umd::Cart::pCartridge->GetSystemBaseFilePath() + filename;
+    sdFile = SD.open(filePath.c_str(), FILE_READ);
+    if(!sdFile){
+        return false;
+    }
+    if(sdFile.size() != totalBytes){
+        sdFile.close();
+        return false;
+    }
+
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarVisibility(true);
+    }
+
+    OperationStartTime = currentTicks;
+    cartridges::Array& source = WriteBuffers[0];
+    CartridgeData.SetTransferSize(totalBytes);
+    bool result = true;
+
+    for(uint32_t addr = 0; addr < totalBytes && result; addr += source.Size())
+    {
+        uint32_t chunkSize = std::min((uint32_t)source.Size(), totalBytes - addr);
+        if((uint32_t)sdFile.read(source.Data(), chunkSize) != chunkSize){
+            result = false;
+            break;
+        }
+
+        if(!differential){
+            result = pCartridge->ProgramFlash(addr, source.Data(), chunkSize, memTypeIndex) == 0;
+            SaveBytesWritten += chunkSize;
+        }else{
+            pCartridge->ReadMemory(addr, CartridgeData, memTypeIndex, cartridges::Cartridge::ReadOptions::NONE);
+            uint32_t i = 0;
+            while(i < chunkSize && result){
+                if(CartridgeData[i] == source[i]){
+                    i++;
+                    continue;
+                }
+                uint32_t run = i;
+                while(i < chunkSize && CartridgeData[i] != source[i]){
+                    i++;
+                }
+                result = pCartridge->ProgramFlash(addr + run, source.Data() + run, i - run, memTypeIndex) == 0;
+                SaveBytesWritten += i - run;
+            }
+        }
+
+        if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
+        {
+            currentTicks = HAL_GetTick();
+            umd::Ux::Display.UpdateProgressBar(addr + chunkSize, totalBytes);
+            umd::Ux::Display.Redraw();
+        }
+    }
+
+    sdFile.close();
+
+    OperationTotalTime = HAL_GetTick() - OperationStartTime;
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarComplete(OperationTotalTime);
+    }
+
+    return result;
+}
+
+/// @brief Write a file from the SD card to the cartridge, only erasing and programming the sectors that differ.
+/// Each sector of the cartridge and of the file is hashed with the hardware CRC, matching sectors are left alone.
+/// The sectors follow the chip's sector map, unknown chips fall back to a full write.
+/// @param memTypeIndex memory to write to
+/// @param filename file name in the system base path
+/// @param updateUi show progress and throughput
+/// @return true on success
+bool umd::Cart::DeltaWriteFromFile(uint8_t memTypeIndex, const std::string& filename, bool updateUi = false){
+    uint32_t currentTicks;
+    uint32_t totalBytes;
+
+    cartridges::FlashInfo info = pCartridge->GetFlashInfo(memTypeIndex);
+    if(info.SectorCount() == 0){
+        return WriteFromFile(memTypeIndex, filename, updateUi);
+    }
+
+    std::string filePath = umd::Cart::pCartridge->GetSystemBaseFilePath() + filename;
+    sdFile = SD.open(filePath.c_str(), FILE_READ);
+
+    if(!sdFile){
+        return false;
+    }
+
+    totalBytes = sdFile.size();
+    if(totalBytes == 0 || totalBytes > info.Size){
+        sdFile.close();
+        return false;
+    }
+
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarVisibility(true);
+    }
+
+    DeltaSectorsChanged = 0;
+    DeltaSectorsTotal = 0;
+    currentTicks = HAL_GetTick();
+    OperationStartTime = currentTicks;
+    bool result = true;
+
+    uint32_t sector = 0;
+    uint32_t sectorSize = 0;
+    for(; sector < totalBytes && result && info.SectorAt(sector, sector, sectorSize); sector += sectorSize)
+    {
+        uint32_t sectorBytes = std::min(sectorSize, totalBytes - sector);
+        DeltaSectorsTotal++;
+
+        // hash the sector on the cartridge
+        pCartridge->ResetChecksumCalculator();
+        CartridgeData.SetTransferSize(sectorBytes);
+        for(uint32_t addr = sector; addr < sector + sectorBytes; addr += CartridgeData.Size()){
+            pCartridge->ReadMemory(addr, CartridgeData, memTypeIndex, cartridges::Cartridge::ReadOptions::CHECKSUM_CALCULATOR);
+        }
+        uint32_t cartCrc = pCartridge->GetAccumulatedChecksum();
+
+        // the checksums only cover whole 32 bit words, the bytes after the last one are compared as they are
+        const uint32_t tailBytes = sectorBytes % 4;
+        std::array<uint8_t, 4> cartTail = {};
+        std::memcpy(cartTail.data(), CartridgeData.Data() + CartridgeData.AvailableSize() - tailBytes, tailBytes);
+
+        // hash the same sector of the file
+        pCartridge->ResetChecksumCalculator();
+        sdFile.seek(sector);
+        for(uint32_t remaining = sectorBytes; remaining > 0; remaining -= CartridgeData.AvailableSize()){
+            int bytesRead = sdFile.read(CartridgeData.Data(), std::min((uint32_t)CartridgeData.Size(), remaining));
+            if(bytesRead <= 0){
+                result = false;
+                break;
+            }
+            CartridgeData.SetAvailableSize(bytesRead);
+            pCartridge->AccumulateChecksum(CartridgeData);
+        }
+        uint32_t fileCrc = pCartridge->GetAccumulatedChecksum();
+        bool tailChanged = result && std::memcmp(cartTail.data(), CartridgeData.Data() + CartridgeData.AvailableSize() - tailBytes, tailBytes) != 0;
+
+        if(result && (cartCrc != fileCrc || tailChanged)){
+            DeltaSectorsChanged++;
+            pCartridge->EraseFlashSector(sector, memTypeIndex);
+            while(pCartridge->IsFlashBusy(memTypeIndex));
+
+            sdFile.seek(sector);
+            result = pCartridge->GetFlashStatus() == cartridges::FlashProgrammer::Status::IDLE
+                && ProgramFromFile(memTypeIndex, sector, sectorBytes, sectorSize, totalBytes, false, false)
+                && VerifyBlockChecksums(memTypeIndex, sector, sectorBytes, sectorSize, false);
+        }
+
+        if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
+        {
+            currentTicks = HAL_GetTick();
+            uint32_t elapsed = currentTicks - OperationStartTime;
+            uint32_t covered = sector + sectorBytes;
+            umd::Ux::Display.UpdateProgressBarRate(covered, totalBytes, elapsed == 0 ? 0 : (uint32_t)(((uint64_t)covered * 1000) / elapsed));
+            umd::Ux::Display.Redraw();
+        }
+    }
+
+    sdFile.close();
+
+    OperationTotalTime = HAL_GetTick() - OperationStartTime;
+    if(updateUi){
+        umd::Ux::Display.SetProgressBarComplete(OperationTotalTime);
+    }
+
+    return result;
+}
+
+/// @brief List the files in the system base path with one of the given extensions into FileNames and FileNamesMenu
+/// @param extensions extensions including the dot, i.e. ".bin"
+/// @return number of files found
+size_t umd::Cart::ListFiles(const std::vector<std::string>& extensions){
+    FileNames.clear();
+    FileNamesMenu.clear();
+
+    File dir = SD.open(pCartridge->GetSystemBaseFilePath().c_str());
+    if(!dir){
+        return 0;
+    }
+
+    File entry = dir.openNextFile();
+    while(entry){
+        if(!entry.isDirectory()){
+            std::string name = entry.name();
+            // keep the file name only
+            size_t slash = name.find_last_of('/');
+            if(slash != std::string::npos){
+                name = name.substr(slash + 1);
+            }
+            for(const auto& extension : extensions){
+                if(name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0){
+                    FileNames.push_back(name);
+                    break;
+                }
+            }
+        }
+        entry.close();
+        entry = dir.openNextFile();
+    }
+    dir.close();
+
+    // the menu points into FileNames, only build it once FileNames won't reallocate anymore
+    for(const auto& name : FileNames){
+        FileNamesMenu.push_back(name.c_str());
+    }
+    return FileNames.size();
+}
+
+/// @brief Move the block map the db has for the identified game to the top of the .crc files listed by ListFiles(),
+/// its menu entry shows the game name rather than the checksum it is named after
+/// @param memTypeIndex memory to check, the db only has maps of ROMs
+void umd::Cart::OfferGameBlockMap(uint8_t memTypeIndex){
+    if(GameId.empty() || pCartridge->IsSaveMemory(memTypeIndex)){
+        return;
+    }
+
+    std::string mapPath = pGameIdentifier->GetBlockMapPath(GameId);
+    if(mapPath.empty()){
+        return;
+    }
+
+    // the db lives in the system base path, its maps are listed with the dumps
+    auto map = std::find(FileNames.begin(), FileNames.end(), mapPath.substr(mapPath.find_last_of('/') + 1));
+    if(map == FileNames.end()){
+        return;
+    }
+    std::rotate(FileNames.begin(), map, map + 1);
+
+    GameBlockMapLabel = "db: " + Name;
+    FileNamesMenu.clear();
+    for(const auto& name : FileNames){
+        FileNamesMenu.push_back(name.c_str());
+    }
+    FileNamesMenu[0] = GameBlockMapLabel.c_str();
+}
+
 /// @brief Identify the cartridge and set the Name property, if the cartridge is identified the Name property will be set to the game name, otherwise it will be set to the checksum
 /// @param updateUi 
 /// @return 
@@ -170,24 +1562,36 @@ bool umd::Cart::Identify(bool updateUi = false){
 
     currentTicks = HAL_GetTick();
     startTicks = currentTicks;
-    pCartridge->ResetChecksumCalculator();
     totalBytes = pCartridge->GetCartridgeSize();
-    CartridgeData.SetTransferSize(totalBytes);
 
     if(updateUi){
         umd::Ux::Display.SetProgressBarVisibility(true);
     }
-    
-    for(int addr = 0; addr < totalBytes; addr += CartridgeData.Size())
+
+    // cartridge -> file order -> checksum -> signatures, the data itself isn't kept
+    CartSource.Configure(*pCartridge, 0, 0, totalBytes, pipeline::CartridgeSource::Mode::IDENTIFY);
+    Checksummer.Configure(*pCartridge, 0, totalBytes);
+    Stream.Reset(CartSource);
+    if(CartSource.IsWordSwapped()){
+        Stream.Add(WordSwap);
+    }
+    Stream.Add(Checksummer);
+    if(Scanner.Configure(pCartridge->GetSignatures())){
+        Stream.Add(Scanner);
+    }
+    Stream.Add(Discard);
+
+    bool streaming = Stream.Begin();
+    while(streaming && !Stream.IsDone() && Stream.Step())
     {
-        umd::Cart::pCartridge->Identify(addr, CartridgeData, cartridges::Cartridge::ReadOptions::CHECKSUM_CALCULATOR);
         if(updateUi && (HAL_GetTick() > currentTicks + umd::Config::PROGRESS_REFRESH_RATE_MS))
         {
             currentTicks = HAL_GetTick();
-            umd::Ux::Display.UpdateProgressBar(addr, totalBytes);
+            umd::Ux::Display.UpdateProgressBar(CartSource.GetAddress(), totalBytes);
             umd::Ux::Display.Redraw();
         }
     }
+    Stream.Finish();
 
     OperationTotalTime = HAL_GetTick() - startTicks;
     if(updateUi){
@@ -199,8 +1603,10 @@ bool umd::Cart::Identify(bool updateUi = false){
     // search the db for the checksum
     if(pGameIdentifier->GameExists(ss.str())){
         umd::Cart::Name = pGameIdentifier->GetGameName(ss.str());
+        umd::Cart::GameId = ss.str();
     }else{
         umd::Cart::Name = ss.str();
+        umd::Cart::GameId.clear();
     }
 
     umd::Cart::IsIdentified = true;
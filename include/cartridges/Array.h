@@ -54,6 +54,15 @@ namespace cartridges{
         /// @return 
         uint16_t& Word(size_t index) { return *reinterpret_cast<uint16_t*>(&mArray[index & 0xFFFFFFFE]); }
 
+        /// @brief Swap the bytes of every 16 bit word of the valid data, i.e. between the order of the bus and the
+        /// order of the file. Works two words at a time, the expression compiles to a single REV16 on the Cortex-M4.
+        void SwapWordBytes(){
+            for(size_t i = 0; i < mAvailableSize; i += 4){
+                uint32_t& value = Long(i);
+                value = ((value << 8) & 0xFF00FF00) | ((value >> 8) & 0x00FF00FF);
+            }
+        }
+
         /// @brief uint32_t access aligned to 4 bytes
         /// @param index 
         /// @return 
@@ -10,11 +10,14 @@
 #include "services/IChecksumCalculator.h"
 #include "Array.h"
 #include "memory/FlashInfo.h"
+#include "memory/IFlashBus.h"
+#include "memory/FlashProgrammer.h"
+#include "memory/FlashInterleaver.h"
 #include "UMDPortsV3.h"
 
 namespace cartridges{
 
-    class Cartridge : public UMDPortsV3 {
+    class Cartridge : public UMDPortsV3, protected IFlashBus {
     public:
 
         Cartridge(IChecksumCalculator& checksumCalculator);
@@ -32,15 +35,47 @@ namespace cartridges{
         /// @brief Options for reading the ROM
         enum ReadOptions : uint8_t{
             NONE = 0,
-            CHECKSUM_CALCULATOR
+            CHECKSUM_CALCULATOR,
+            // leave the data in the order of the bus, see IsBusOrderSwapped()
+            BUS_ORDER
         };
 
+        /// @brief Results of the verified reads since the last ResetVerifyStats()
+        struct VerifyStats{
+            uint32_t Blocks = 0;
+            uint32_t RetriedBlocks = 0;
+            uint32_t Retries = 0;
+            // blocks where no read agreed with the vote, the data is the bitwise majority of the last reads
+            uint32_t UnsettledBlocks = 0;
+            uint32_t FirstRetriedAddress = 0;
+        };
+
+        // extra reads of a block that keeps reading back differently, before giving up on it
+        static constexpr uint8_t MAX_VERIFY_RETRIES = 8;
+
         /// @brief Reset the checksum calculator
         void ResetChecksumCalculator();
         std::vector<const char *>& GetMemoryNames() { return mMemoryNames; };
         std::vector<const char *>& GetMetadata() { return mMetadata; };
+        /// @brief Strings whose presence in the ROM tells the save type or the hardware of the cartridge
+        const std::vector<const char *>& GetSignatures() const { return mSignatures; };
         uint32_t GetAccumulatedChecksum() { return mChecksumCalculator.Get(); };
 
+        /// @brief Accumulate the valid bytes of an array into the checksum calculator, i.e. data read from the SD card
+        uint32_t AccumulateChecksum(cartridges::Array& array) { return mChecksumCalculator.Accumulate(&array.Long(0), array.AvailableSize()/4); }
+
+        /// @brief Combine the checksums of two blocks computed from a reset into the checksum of both blocks
+        uint32_t CombineChecksums(uint32_t checksumA, uint32_t checksumB, uint32_t lengthB) { return mChecksumCalculator.Combine(checksumA, checksumB, lengthB); }
+
+        /// @brief Get the throughput of the flash programming engine
+        FlashProgrammer::Stats GetFlashStats() const { return mFlash.GetStats(); }
+
+        /// @brief Number of flash chips found by the last GetFlashInfo()
+        uint8_t GetFlashChipCount() const { return mFlash.GetChipCount(); }
+
+        /// @brief Get the result of the last operation on one of the flash chips, IsFlashBusy() advances them all
+        FlashProgrammer::Status GetFlashChipStatus(uint8_t chip) const { return mFlash.GetChipStatus(chip); }
+
         /// @brief Initialize the IO for the system
         virtual void InitIO () = 0;
         
@@ -64,6 +99,19 @@ namespace cartridges{
         virtual FlashInfo GetFlashInfo(uint8_t memTypeIndex) = 0;
         virtual int EraseFlash(uint8_t memTypeIndexm) = 0;
 
+        /// @brief Start erasing the flash sector containing the address, IsFlashBusy() reports completion
+        /// @param address any byte address within the sector
+        /// @param memTypeIndex The memory to erase
+        /// @return 0 if the erase started, -1 on failure
+        virtual int EraseFlashSector(uint32_t address, uint8_t memTypeIndex) = 0;
+
+        /// @brief Start erasing only the flash sectors covering a range, IsFlashBusy() reports completion
+        /// @param address start byte address of the range
+        /// @param size number of bytes in the range
+        /// @param memTypeIndex The memory to erase
+        /// @return 0 if the erase started, -1 on failure
+        virtual int EraseFlashRange(uint32_t address, uint32_t size, uint8_t memTypeIndex) = 0;
+
         /// @brief Identify the cartridge by reading all its data and computing a checksum
         /// @param address The start address to read from
         /// @param buffer The buffer to read into
@@ -74,19 +122,84 @@ namespace cartridges{
 
         virtual uint32_t ReadMemory(uint32_t address, cartridges::Array& array, uint8_t memTypeIndex, ReadOptions opt) = 0;
 
+        /// @brief Read like ReadMemory(), but the block is read twice and the reads compared. A block that reads back
+        /// differently is read again and settled by a bitwise majority vote of the last three reads, until a read
+        /// agrees with the vote or MAX_VERIFY_RETRIES is reached. Dirty contacts show up as retries.
+        /// @param address The start address to read from
+        /// @param array The array to read into, the transfer size advances once as with ReadMemory()
+        /// @param memTypeIndex The memory to read from
+        /// @param opt CHECKSUM_CALCULATOR accumulates the settled data only, BUS_ORDER votes on the raw reads
+        /// @return number of extra reads the block needed, 0 if the first two reads agreed
+        uint8_t ReadMemoryVerified(uint32_t address, cartridges::Array& array, uint8_t memTypeIndex, ReadOptions opt);
+
+        const VerifyStats& GetVerifyStats() const { return mVerifyStats; }
+        void ResetVerifyStats() { mVerifyStats = VerifyStats(); }
+
+        /// @brief Program a block of data into flash, the flash is expected to be erased
+        /// @param address The start byte address to program
+        /// @param buffer The data to program, in file order
+        /// @param size The number of bytes to program
+        /// @param memTypeIndex The memory to program
+        /// @return 0 on success, -1 on failure
         virtual int ProgramFlash(uint32_t address, uint8_t *buffer, uint16_t size, uint8_t memTypeIndex) = 0;
+
+        /// @brief Start programming a block of data into flash and return without waiting, IsFlashBusy() advances
+        /// the operation. The buffer must not be modified until IsFlashBusy() returns false.
+        /// @param address The start byte address to program
+        /// @param buffer The data to program, in file order
+        /// @param size The number of bytes to program
+        /// @param memTypeIndex The memory to program
+        /// @return 0 if the operation started, -1 on failure
+        virtual int BeginProgramFlash(uint32_t address, const uint8_t *buffer, uint16_t size, uint8_t memTypeIndex) = 0;
     
+        /// @brief Check if the flash is busy, advances a program operation started with BeginProgramFlash()
         virtual bool IsFlashBusy(uint8_t memTypeIndex) = 0;
 
+        /// @brief Get the result of the last program operation
+        FlashProgrammer::Status GetFlashStatus() const { return mFlash.GetStatus(); }
+
+        /// @brief Does a read with BUS_ORDER leave the bytes of each 16 bit word swapped relative to the file, the
+        /// caller then runs Array::SwapWordBytes() over the buffer if it needs the file order
+        virtual bool IsBusOrderSwapped(uint8_t memTypeIndex) const { return false; }
+
+        /// @brief Get the type of a memory from its index in the memory names
+        MemoryType GetMemoryType(uint8_t memTypeIndex) const { return mMemoryTypeIndexMap.at(memTypeIndex); }
+
+        /// @brief Is the memory a battery backed save memory rather than a ROM
+        bool IsSaveMemory(uint8_t memTypeIndex) const {
+            if(!IsMemoryIndexValid(memTypeIndex)){
+                return false;
+            }
+            MemoryType mem = GetMemoryType(memTypeIndex);
+            return mem == MemoryType::RAM0 || mem == MemoryType::RAM1 || mem == MemoryType::BRAM;
+        }
+
     protected:
 
         IChecksumCalculator& mChecksumCalculator;
+        FlashInterleaver mFlash;
         std::map<uint8_t, Cartridge::MemoryType> mMemoryTypeIndexMap;
         std::vector<const char *> mMemoryNames;
         std::vector<const char *> mMetadata;
+        std::vector<const char *> mSignatures;
+        // second read of a verified block, and the read that votes when the first two differ
+        cartridges::Array mVerifyArray;
+        cartridges::Array mVoteArray;
+        VerifyStats mVerifyStats;
 
         bool IsMemoryIndexValid(uint8_t memTypeIndex) const {
             return memTypeIndex < mMemoryNames.size();
         }
+
+        /// @brief Look up the flash chip in the table of known chips, or read its geometry with a CFI query if it
+        /// isn't in the table, count the identical chips following it and configure the programming engine for them.
+        /// Must be called in read array mode.
+        /// @param manufacturer manufacturer ID from the autoselect command
+        /// @param device device ID from the autoselect command
+        /// @param maxSize number of bytes reachable on the bus
+        FlashInfo IdentifyFlash(uint16_t manufacturer, uint16_t device, uint32_t maxSize);
+
+        /// @brief Count the chips answering the autoselect command with the same ID at multiples of the chip size
+        uint8_t CountFlashChips(uint16_t manufacturer, uint16_t device, uint32_t chipSize, uint32_t maxSize);
     };
 }
\ No newline at end of file
@@ -33,11 +33,15 @@ namespace cartridges::genesis{
 
         virtual FlashInfo GetFlashInfo(uint8_t memTypeIndex) override;
         virtual int EraseFlash(uint8_t memTypeIndex) override;
+        virtual int EraseFlashSector(uint32_t address, uint8_t memTypeIndex) override;
+        virtual int EraseFlashRange(uint32_t address, uint32_t size, uint8_t memTypeIndex) override;
         virtual uint32_t Identify(uint32_t address, cartridges::Array& array, ReadOptions opt) override;
 
         virtual uint32_t ReadMemory(uint32_t address, cartridges::Array& array, uint8_t memTypeIndex, ReadOptions opt) override;
+        virtual bool IsBusOrderSwapped(uint8_t memTypeIndex) const override;
 
         virtual int ProgramFlash(uint32_t address, uint8_t *buffer, uint16_t size, uint8_t memTypeIndex) override;
+        virtual int BeginProgramFlash(uint32_t address, const uint8_t *buffer, uint16_t size, uint8_t memTypeIndex) override;
         virtual bool IsFlashBusy(uint8_t memTypeIndex) override;
         
     private:
@@ -46,29 +50,33 @@ namespace cartridges::genesis{
         const std::string mSystemName = "MD";
         const std::string mSystemBaseFilePath = "/UMD/MD/";
 
-        std::map<int, MemoryType> mMemoryTypeIndexMap = {
-            {0, MemoryType::PRG0},
-            {1, MemoryType::RAM0},
-            {2, MemoryType::BRAM}
-        };
-
-        std::vector<std::string> mMemoryNames = {
-            "ROM",
-            "Save RAM",
-            "SCD Backup RAM"
-        };
-
         const uint32_t HEADER_START_ADDR = 0x00000100;
         const uint32_t HEADER_SIZE = 256;
         const uint32_t TIME_CONFIG_ADDR = 0xA130F1;
+        const uint32_t PRG_ADDRESS_SPACE = 0x1000000;
+
+        // RAMType bits 4-3 of the header, which byte lanes the SRAM is wired to
+        static constexpr uint8_t SRAM_LANES_BOTH = 0;
+        static constexpr uint8_t SRAM_LANES_EVEN = 2;
+        static constexpr uint8_t SRAM_LANES_ODD = 3;
+
+        // SRAM layout from the header, the save file packs the bytes of byte wide SRAM
+        uint32_t mSramStart = 0;
+        uint32_t mSramSize = 0;
+        uint8_t mSramStride = 0;
 
         void ReadHeader();
         bool calculateChecksum(uint32_t start, uint32_t end);
         
         // PRG
         uint16_t ReadPrgWord(uint32_t address);
+        // the word as it is on the bus, the ROM is big endian
+        uint16_t ReadPrgBusWord(uint32_t address);
         void WritePrgWord(uint32_t address, uint16_t data);
-        uint8_t TogglePrgBit(uint8_t attempts);
+
+        // IFlashBus, flash on the PRG bus
+        virtual void FlashWrite(uint32_t wordAddress, uint16_t data) override;
+        virtual uint16_t FlashRead(uint32_t wordAddress) override;
 
         uint8_t readPrgByte(uint32_t address);
         void writePrgByte(uint32_t address, uint8_t data);
@@ -76,6 +84,12 @@ namespace cartridges::genesis{
         
         void enableSram(bool enable);
 
+        // SRAM, the address is an offset into the save file
+        uint32_t SramAddress(uint32_t offset) const { return mSramStart + offset * mSramStride; }
+        uint8_t ReadSramByte(uint32_t address);
+        void WriteSramByte(uint32_t address, uint8_t data);
+        bool WriteSram(uint32_t offset, const uint8_t *buffer, uint16_t size);
+
         // rename Genesis CE pins
         __attribute__((always_inline)) void setTIME() { setCE0(); }
         __attribute__((always_inline)) void setAS() { setCE1(); }
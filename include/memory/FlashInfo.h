@@ -1,97 +1,252 @@
 #pragma once
 
 #include <cstdint>
+#include <algorithm>
 
 namespace cartridges{
 
+    /// @brief A run of equally sized erase sectors
+    struct SectorRegion{
+        uint16_t Count;
+        uint32_t Size;
+    };
+
+    /// @brief Program and erase times from the datasheet
+    struct FlashTimings{
+        uint16_t WordProgramUs;
+        uint16_t BufferProgramUs;
+        uint32_t SectorEraseMs;
+        uint32_t ChipEraseMs;
+    };
+
+    /// @brief Description of a known flash chip, the sector map is listed from the lowest address up
+    struct FlashChip{
+        static constexpr uint8_t MAX_REGIONS = 4;
+
+        uint16_t Manufacturer;
+        uint16_t Device;
+        const char *Name;
+        uint32_t Size;
+        uint16_t WriteBufferSize;
+        bool UnlockBypass;
+        /// @brief more sectors can be queued during the sector erase timeout window after the first 0x30 command
+        bool SectorEraseBatch;
+        uint8_t RegionCount;
+        SectorRegion Regions[MAX_REGIONS];
+        FlashTimings Typical;
+        FlashTimings Max;
+
+        constexpr uint32_t Key() const { return ((uint32_t)Manufacturer << 16) | Device; }
+    };
+
+    /// @brief uniform map of the 32KW blocks of the SST39, erased by the 0x30 command
+    constexpr SectorRegion SstBlocks(uint32_t size) { return { (uint16_t)(size / 0x10000), 0x10000 }; }
+
+    // timings in the order word program us, buffer program us, sector erase ms, chip erase ms
+    inline constexpr FlashTimings S29GL_N_TYP   = { 60, 240, 500, 256000 };
+    inline constexpr FlashTimings S29GL_N_MAX   = { 400, 1600, 3500, 1024000 };
+    inline constexpr FlashTimings SST39_TYP     = { 7, 0, 18, 40 };
+    inline constexpr FlashTimings SST39_MAX     = { 10, 0, 25, 50 };
+    inline constexpr FlashTimings MX29LV_TYP    = { 11, 0, 700, 50000 };
+    inline constexpr FlashTimings MX29LV_MAX    = { 360, 0, 15000, 200000 };
+    inline constexpr FlashTimings MX29F_TYP     = { 9, 0, 700, 8000 };
+    inline constexpr FlashTimings MX29F_MAX     = { 300, 0, 15000, 64000 };
+
+    /// @brief known chips, must stay sorted by manufacturer then device for the binary search in FlashInfo::Find()
+    inline constexpr FlashChip KNOWN_FLASH_CHIPS[] = {
+        // spansion, only the first 16MB are reachable with a 24 bit address bus
+        { 0x01, 0x007E, "S29GL512N",    0x1000000, 64, true, true, 1, { { 128, 0x20000 } }, S29GL_N_TYP, S29GL_N_MAX },
+        { 0x01, 0x227E, "S29GL512N",    0x1000000, 64, true, true, 1, { { 128, 0x20000 } }, S29GL_N_TYP, S29GL_N_MAX },
+
+        // microchip, sector erase (0x30) on the SST39 erases a 32KW block
+        { 0xBF, 0x004A, "SST39VF1602",  0x200000, 0, false, false, 1, { SstBlocks(0x200000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x004B, "SST39VF1601",  0x200000, 0, false, false, 1, { SstBlocks(0x200000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x004E, "SST39VF1602C", 0x200000, 0, false, false, 1, { SstBlocks(0x200000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x004F, "SST39VF1601C", 0x200000, 0, false, false, 1, { SstBlocks(0x200000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x005A, "SST39VF3202",  0x400000, 0, false, false, 1, { SstBlocks(0x400000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x005B, "SST39VF3201",  0x400000, 0, false, false, 1, { SstBlocks(0x400000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x005C, "SST39VF3202B", 0x400000, 0, false, false, 1, { SstBlocks(0x400000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x005D, "SST39VF3201B", 0x400000, 0, false, false, 1, { SstBlocks(0x400000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x006C, "SST39VF6402B", 0x800000, 0, false, false, 1, { SstBlocks(0x800000) }, SST39_TYP, SST39_MAX },
+        { 0xBF, 0x006D, "SST39VF6401B", 0x800000, 0, false, false, 1, { SstBlocks(0x800000) }, SST39_TYP, SST39_MAX },
+
+        // macronix
+        { 0xC2, 0x0023, "MX29F400CT",   0x80000,  0, true, true, 4, { { 7, 0x10000 }, { 1, 0x8000 }, { 2, 0x2000 }, { 1, 0x4000 } }, MX29F_TYP, MX29F_MAX },
+        { 0xC2, 0x0049, "MX29LV160DB",  0x200000, 0, true, true, 4, { { 1, 0x4000 }, { 2, 0x2000 }, { 1, 0x8000 }, { 31, 0x10000 } }, MX29LV_TYP, MX29LV_MAX },
+        { 0xC2, 0x0051, "MX29F200CT",   0x40000,  0, true, true, 4, { { 3, 0x10000 }, { 1, 0x8000 }, { 2, 0x2000 }, { 1, 0x4000 } }, MX29F_TYP, MX29F_MAX },
+        { 0xC2, 0x0057, "MX29F200CB",   0x40000,  0, true, true, 4, { { 1, 0x4000 }, { 2, 0x2000 }, { 1, 0x8000 }, { 3, 0x10000 } }, MX29F_TYP, MX29F_MAX },
+        { 0xC2, 0x0058, "MX29F800CT",   0x100000, 0, true, true, 4, { { 15, 0x10000 }, { 1, 0x8000 }, { 2, 0x2000 }, { 1, 0x4000 } }, MX29F_TYP, MX29F_MAX },
+        { 0xC2, 0x00A7, "MX29LV320ET",  0x400000, 0, true, true, 2, { { 63, 0x10000 }, { 8, 0x2000 } }, MX29LV_TYP, MX29LV_MAX },
+        { 0xC2, 0x00A8, "MX29LV320EB",  0x400000, 0, true, true, 2, { { 8, 0x2000 }, { 63, 0x10000 } }, MX29LV_TYP, MX29LV_MAX },
+        { 0xC2, 0x00AB, "MX29F400CB",   0x80000,  0, true, true, 4, { { 1, 0x4000 }, { 2, 0x2000 }, { 1, 0x8000 }, { 7, 0x10000 } }, MX29F_TYP, MX29F_MAX },
+        { 0xC2, 0x00C4, "MX29LV160DT",  0x200000, 0, true, true, 4, { { 31, 0x10000 }, { 1, 0x8000 }, { 2, 0x2000 }, { 1, 0x4000 } }, MX29LV_TYP, MX29LV_MAX },
+        { 0xC2, 0x00C9, "MX29LV640ET",  0x800000, 0, true, true, 2, { { 127, 0x10000 }, { 8, 0x2000 } }, MX29LV_TYP, MX29LV_MAX },
+        { 0xC2, 0x00CB, "MX29LV640EB",  0x800000, 0, true, true, 2, { { 8, 0x2000 }, { 127, 0x10000 } }, MX29LV_TYP, MX29LV_MAX },
+        { 0xC2, 0x00D6, "MX29F800CB",   0x100000, 0, true, true, 4, { { 1, 0x4000 }, { 2, 0x2000 }, { 1, 0x8000 }, { 15, 0x10000 } }, MX29F_TYP, MX29F_MAX },
+        { 0xC2, 0x2223, "MX29F400CT",   0x80000,  0, true, true, 4, { { 7, 0x10000 }, { 1, 0x8000 }, { 2, 0x2000 }, { 1, 0x4000 } }, MX29F_TYP, MX29F_MAX },
+        { 0xC2, 0x22A7, "MX29LV320ET",  0x400000, 0, true, true, 2, { { 63, 0x10000 }, { 8, 0x2000 } }, MX29LV_TYP, MX29LV_MAX },
+        { 0xC2, 0x22A8, "MX29LV320EB",  0x400000, 0, true, true, 2, { { 8, 0x2000 }, { 63, 0x10000 } }, MX29LV_TYP, MX29LV_MAX },
+        { 0xC2, 0x22AB, "MX29F400CB",   0x80000,  0, true, true, 4, { { 1, 0x4000 }, { 2, 0x2000 }, { 1, 0x8000 }, { 7, 0x10000 } }, MX29F_TYP, MX29F_MAX },
+    };
+
+    constexpr uint32_t KNOWN_FLASH_CHIP_COUNT = sizeof(KNOWN_FLASH_CHIPS) / sizeof(KNOWN_FLASH_CHIPS[0]);
+
+    constexpr bool IsFlashTableSorted(){
+        for(uint32_t i = 1; i < KNOWN_FLASH_CHIP_COUNT; i++){
+            if(KNOWN_FLASH_CHIPS[i - 1].Key() >= KNOWN_FLASH_CHIPS[i].Key()){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr bool IsFlashTableMapComplete(){
+        for(const FlashChip& chip : KNOWN_FLASH_CHIPS){
+            uint32_t total = 0;
+            for(uint8_t i = 0; i < chip.RegionCount; i++){
+                total += (uint32_t)chip.Regions[i].Count * chip.Regions[i].Size;
+            }
+            if(total != chip.Size){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(IsFlashTableSorted(), "KNOWN_FLASH_CHIPS must be sorted by manufacturer and device");
+    static_assert(IsFlashTableMapComplete(), "sector maps must cover the whole chip");
+
     class FlashInfo{
     public:
         uint16_t Manufacturer = 0;
         uint16_t Device = 0;
         uint32_t Size = 0;
+        /// @brief size of the write buffer in bytes, 0 if the chip can't do buffered programming
+        uint16_t WriteBufferSize = 0;
+        /// @brief chip accepts the unlock bypass (0x20) command for 2 cycle word programming
+        bool UnlockBypass = false;
+        /// @brief size of an erase sector in bytes for chips with uniform sectors, 0 for boot block layouts
+        uint32_t SectorSize = 0;
+        /// @brief geometry and timings of the chip, from the table of known chips or from a CFI query
+        FlashChip Chip = {};
+        /// @brief number of identical chips one after the other in the address space, Size covers all of them
+        uint8_t ChipCount = 1;
 
         FlashInfo(uint16_t manufacturer, uint16_t device)
-            : Manufacturer(manufacturer), Device(device), Size(0)
+            : Manufacturer(manufacturer), Device(device)
+        {
+            const FlashChip *known = Find(manufacturer, device);
+            if(known != nullptr){
+                SetGeometry(*known);
+            }
+        }
+
+        /// @brief Build the info from a descriptor that isn't in the table, i.e. from a CFI query
+        FlashInfo(uint16_t manufacturer, uint16_t device, const FlashChip& chip)
+            : Manufacturer(manufacturer), Device(device)
         {
-            switch(Manufacturer){
-                // spansion
-                case 0x01:
-                switch(Device)
-                    {
-                        case 0x7E: // S29GL512N
-                        case 0x227E:
-                            Size = 0x1000000;
-                            break;
-                        default:
-                            break;
-                    }
-                    break;
-                // microchip
-                case 0xBF:
-                    switch(Device)
-                    {
-                        case 0x6D: // SST39VF6401B
-                        case 0x6C: // SST39VF6402B
-                            Size = 0x800000;
-                            break;
-                        case 0x5D: // SST39VF3201B
-                        case 0x5C: // SST39VF3202B
-                        case 0x5B: // SST39VF3201
-                        case 0x5A: // SST39VF3202
-                            Size = 0x400000;
-                            break;
-                        case 0x4F: // SST39VF1601C
-                        case 0x4E: // SST39VF1602C
-                        case 0x4B: // SST39VF1601
-                        case 0x4A: // SST39VF1602
-                            Size = 0x200000;
-                            break;
-                        default:
-                            break;
-                    }
-                    break;
-                
-                // macronix
-                case 0xC2:
-                    switch(Device)
-                    {
-                        case 0xC9: // MX29LV640ET
-                        case 0xCB: // MX29LV640EB
-                            Size = 0x800000;
-                            break;
-                        case 0xA7: // MX29LV320ET
-                        case 0x22A7:
-                        case 0xA8: // MX29LV320EB
-                        case 0x22A8:
-                            Size = 0x400000;
-                            break;
-                        case 0xC4: // MX29LV160DT
-                        case 0x49: // MX29LV160DB
-                            Size = 0x200000;
-                            break;    
-                        // 5V
-                        case 0x58: // MX29F800CT
-                        case 0xD6: // MX29F800CB
-                            Size = 0x100000;
-                            break;
-                        case 0x23: // MX29F400CT
-                        case 0x2223:
-                        case 0xAB: // MX29F400CB
-                        case 0x22AB:
-                            Size = 0x80000;
-                            break;
-                        case 0x51: // MX29F200CT
-                        case 0x57: // MX29F200CB
-                            Size = 0x40000;
-                            break;
-                        default:
-                            break;
-                    }
-                    break;
-                    
-                default:
-                    break;
+            SetGeometry(chip);
+        }
+
+        /// @brief Is the geometry of the chip known, from the table or from CFI
+        bool HasGeometry() const { return Chip.RegionCount != 0; }
+
+        /// @brief Describe a board made of several identical chips, chip n starts at n times the chip size
+        void SetChipCount(uint8_t count){
+            ChipCount = count;
+            Size = Chip.Size * count;
+        }
+
+        /// @brief Number of erase sectors in all the chips
+        uint32_t SectorCount() const {
+            uint32_t count = 0;
+            for(uint8_t i = 0; i < Chip.RegionCount; i++){
+                count += Chip.Regions[i].Count;
+            }
+            return count * ChipCount;
+        }
+
+        /// @brief Find the erase sector containing an address
+        /// @param address byte address in the chip
+        /// @param sectorStart byte address of the first byte of the sector
+        /// @param sectorSize size of the sector in bytes
+        /// @return false if the address is outside the chip or the chip is unknown
+        bool SectorAt(uint32_t address, uint32_t& sectorStart, uint32_t& sectorSize) const {
+            if(Chip.Size == 0 || address / Chip.Size >= ChipCount){
+                return false;
+            }
+
+            // every chip has the same map
+            uint32_t regionStart = (address / Chip.Size) * Chip.Size;
+            for(uint8_t i = 0; i < Chip.RegionCount; i++){
+                const SectorRegion& region = Chip.Regions[i];
+                uint32_t regionBytes = (uint32_t)region.Count * region.Size;
+                if(address < regionStart + regionBytes){
+                    sectorSize = region.Size;
+                    sectorStart = regionStart + ((address - regionStart) / region.Size) * region.Size;
+                    return true;
+                }
+                regionStart += regionBytes;
             }
+            return false;
+        }
+
+        /// @brief Number of erase sectors covering a range of bytes
+        uint32_t SectorsInRange(uint32_t address, uint32_t size) const {
+            uint32_t count = 0;
+            uint32_t sectorStart, sectorSize;
+            for(uint32_t end = address + size; address < end && SectorAt(address, sectorStart, sectorSize); address = sectorStart + sectorSize){
+                count++;
+            }
+            return count;
+        }
+
+        /// @brief Typical time to erase a range of bytes, sector by sector or with a chip erase whichever is faster
+        uint32_t EstimateEraseMs(uint32_t address, uint32_t size) const {
+            uint32_t sectorsMs = SectorsInRange(address, size) * Chip.Typical.SectorEraseMs;
+            return Chip.Typical.ChipEraseMs != 0 ? std::min(sectorsMs, Chip.Typical.ChipEraseMs) : sectorsMs;
+        }
+
+        /// @brief Typical time to program a range of bytes, assuming nothing is blank and the chips are interleaved
+        uint32_t EstimateProgramMs(uint32_t bytes) const {
+            bytes = (bytes + ChipCount - 1) / ChipCount;
+            if(Chip.WriteBufferSize > 1){
+                uint32_t pages = (bytes + Chip.WriteBufferSize - 1) / Chip.WriteBufferSize;
+                return (uint32_t)(((uint64_t)pages * Chip.Typical.BufferProgramUs) / 1000);
+            }
+            return (uint32_t)(((uint64_t)(bytes >> 1) * Chip.Typical.WordProgramUs) / 1000);
+        }
+
+        /// @brief Look up a chip in the table of known chips
+        /// @return the table entry or nullptr if the chip is unknown
+        static constexpr const FlashChip* Find(uint16_t manufacturer, uint16_t device){
+            uint32_t key = ((uint32_t)manufacturer << 16) | device;
+            uint32_t low = 0;
+            uint32_t high = KNOWN_FLASH_CHIP_COUNT;
+
+            while(low < high){
+                uint32_t mid = (low + high) >> 1;
+                if(KNOWN_FLASH_CHIPS[mid].Key() < key){
+                    low = mid + 1;
+                }else{
+                    high = mid;
+                }
+            }
+
+            if(low < KNOWN_FLASH_CHIP_COUNT && KNOWN_FLASH_CHIPS[low].Key() == key){
+                return &KNOWN_FLASH_CHIPS[low];
+            }
+            return nullptr;
+        }
+
+    private:
+
+        void SetGeometry(const FlashChip& chip){
+            Chip = chip;
+            Size = chip.Size;
+            WriteBufferSize = chip.WriteBufferSize;
+            UnlockBypass = chip.UnlockBypass;
+            SectorSize = chip.RegionCount == 1 ? chip.Regions[0].Size : 0;
         }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "memory/IFlashBus.h"
+#include "memory/FlashInfo.h"
+#include "memory/FlashProgrammer.h"
+
+namespace cartridges{
+
+    /// @brief Runs one FlashProgrammer per chip for boards made of several identical flash chips decoded by address.
+    /// Every chip is polled on its own, so while one chip is busy with a program or erase the others can be given
+    /// work, getting close to N times the throughput of a single chip. A single chip board is just the N = 1 case.
+    class FlashInterleaver{
+    public:
+
+        static constexpr uint8_t MAX_CHIPS = 4;
+
+        FlashInterleaver(IFlashBus& bus);
+
+        /// @brief Configure every chip, chip n is based at n times the chip size
+        /// @param info flash info of the board, ChipCount gives the number of chips
+        void Configure(const FlashInfo& info);
+
+        bool IsConfigured() const { return mChips[0].IsConfigured(); }
+        uint8_t GetChipCount() const { return mChipCount; }
+
+        /// @brief Size of a single chip in words
+        uint32_t GetChipWords() const { return mChipWords; }
+
+        /// @brief Start programming words, routed to the chip containing the address. The range must not cross chips.
+        FlashProgrammer::Status BeginProgram(uint32_t wordAddress, const uint8_t *data, uint32_t words);
+
+        /// @brief Start erasing the sector containing the address on the chip containing it
+        FlashProgrammer::Status BeginSectorErase(uint32_t wordAddress);
+
+        /// @brief Start erasing every chip, all at the same time
+        FlashProgrammer::Status BeginChipErase();
+
+        /// @brief Start erasing the sectors covering a range, each chip erases its part at the same time
+        FlashProgrammer::Status BeginEraseRange(uint32_t wordAddress, uint32_t words);
+
+        /// @brief Advance the operation of every chip without blocking
+        /// @return BUSY while any chip is busy, the first error, or IDLE once every chip is done
+        FlashProgrammer::Status Service();
+
+        /// @brief Is any chip toggling DQ6
+        bool IsToggling();
+
+        /// @brief Query the first chip with CFI
+        bool QueryCfi(FlashChip& chip, uint32_t maxSize) { return mChips[0].QueryCfi(chip, maxSize); }
+
+        /// @brief Status of a single chip
+        FlashProgrammer::Status GetChipStatus(uint8_t chip) const { return mChips[chip].GetStatus(); }
+
+        /// @brief Status of the board, see Service()
+        FlashProgrammer::Status GetStatus() const;
+
+        /// @brief Statistics of all the chips, the time is the longest of the chips since they run side by side
+        FlashProgrammer::Stats GetStats() const;
+        void ResetStats();
+
+    private:
+
+        /// @brief Offsets the word address of the commands so each chip sees its own command addresses
+        class ChipBus : public IFlashBus{
+        public:
+            ChipBus(IFlashBus& bus) : mBus(bus) {}
+            uint32_t mBase = 0;
+            virtual void FlashWrite(uint32_t wordAddress, uint16_t data) override { mBus.FlashWrite(mBase + wordAddress, data); }
+            virtual uint16_t FlashRead(uint32_t wordAddress) override { return mBus.FlashRead(mBase + wordAddress); }
+        private:
+            IFlashBus& mBus;
+        };
+
+        std::array<ChipBus, MAX_CHIPS> mBuses;
+        std::array<FlashProgrammer, MAX_CHIPS> mChips;
+        uint8_t mChipCount = 1;
+        uint32_t mChipWords = 0;
+
+        /// @brief chip containing a word address, clamped to the last chip
+        uint8_t ChipAt(uint32_t wordAddress) const;
+    };
+}
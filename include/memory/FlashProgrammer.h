@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstdint>
+
+#include "memory/IFlashBus.h"
+#include "memory/FlashInfo.h"
+
+namespace cartridges{
+
+    /// @brief Programming engine for flash chips using the AMD command set. Operations are started with Begin*()
+    /// and advanced with Service(), which never blocks, so the caller can do other work while the chip is busy.
+    class FlashProgrammer{
+    public:
+
+        enum class Status : uint8_t{
+            IDLE = 0,
+            BUSY,
+            ERROR_TIMEOUT,
+            ERROR_ABORT,
+            ERROR_NOT_CONFIGURED
+        };
+
+        /// @brief Programming throughput accounting
+        struct Stats{
+            uint32_t WordsProgrammed = 0;
+            uint32_t WordsSkipped = 0;
+            uint32_t Millis = 0;
+            uint32_t SectorsErased = 0;
+
+            /// @brief words covered per second, blank words that were skipped count as covered
+            uint32_t WordsPerSecond() const {
+                return Millis == 0 ? 0 : (uint32_t)(((uint64_t)(WordsProgrammed + WordsSkipped) * 1000) / Millis);
+            }
+        };
+
+        FlashProgrammer(IFlashBus& bus);
+
+        /// @brief Select the programming algorithm for the chip, must be called before programming
+        /// @param info flash info of the chip, usually from Cartridge::GetFlashInfo()
+        void Configure(const FlashInfo& info);
+
+        /// @brief Has the engine been configured for a known chip
+        bool IsConfigured() const { return mChipSize != 0; }
+
+        /// @brief Start programming words, blank (0xFFFF) words are skipped since the chip is expected to be erased
+        /// @param wordAddress first word address to program
+        /// @param data data in file order, i.e. the even byte is the high byte of the word on the bus
+        /// @param words number of words to program, the data must stay valid until the operation completes
+        /// @return BUSY if the operation started, an error otherwise
+        Status BeginProgram(uint32_t wordAddress, const uint8_t *data, uint32_t words);
+
+        /// @brief Advance the current operation without blocking
+        /// @return BUSY while the operation is in progress, IDLE once done, or an error
+        Status Service();
+
+        /// @brief Program words and wait for completion
+        Status Program(uint32_t wordAddress, const uint8_t *data, uint32_t words);
+
+        /// @brief Start erasing the sector containing the address
+        /// @param wordAddress any word address within the sector
+        /// @return BUSY if the operation started, an error otherwise
+        Status BeginSectorErase(uint32_t wordAddress);
+
+        /// @brief Start erasing the whole chip
+        /// @return BUSY if the operation started
+        Status BeginChipErase();
+
+        /// @brief Start erasing the sectors covering a range, from the sector map of the chip. Sectors are queued in
+        /// batches during the sector erase timeout window when the chip allows it, and a chip erase is used instead
+        /// when the range covers the whole chip or would take longer sector by sector.
+        /// @param wordAddress first word address of the range
+        /// @param words number of words in the range
+        /// @return BUSY if the operation started, an error otherwise
+        Status BeginEraseRange(uint32_t wordAddress, uint32_t words);
+
+        /// @brief Check DQ6, which toggles on every read while the chip is busy with an embedded algorithm
+        bool IsToggling();
+
+        /// @brief Read the geometry of the chip with a JEDEC CFI query, for chips missing from the table
+        /// @param chip filled with the size, sector map, write buffer size and timings reported by the chip
+        /// @param maxSize number of bytes reachable on the bus, the sector map is truncated to it
+        /// @return false if the chip doesn't answer the query
+        bool QueryCfi(FlashChip& chip, uint32_t maxSize);
+
+        Status GetStatus() const { return mStatus; }
+        const Stats& GetStats() const { return mStats; }
+        void ResetStats() { mStats = Stats(); }
+
+    private:
+
+        enum class Mode : uint8_t{
+            WORD,           // 4 cycle word program
+            UNLOCK_BYPASS,  // 2 cycle word program while in unlock bypass
+            WRITE_BUFFER    // buffered program of a full page
+        };
+
+        enum class Operation : uint8_t{
+            PROGRAM,
+            ERASE
+        };
+
+        enum class PollResult : uint8_t{
+            READY,
+            BUSY,
+            FAILED
+        };
+
+        // command addresses, as word addresses
+        static constexpr uint32_t CMD_ADDR_1 = 0x00000555;
+        static constexpr uint32_t CMD_ADDR_2 = 0x000002AA;
+
+        // status bits
+        static constexpr uint16_t DQ7 = 0x0080;
+        static constexpr uint16_t DQ6 = 0x0040;
+        static constexpr uint16_t DQ5 = 0x0020;
+        static constexpr uint16_t DQ3 = 0x0008;
+        static constexpr uint16_t DQ1 = 0x0002;
+
+        static constexpr uint16_t BLANK_WORD = 0xFFFF;
+
+        // CFI query, word addresses of the fields
+        static constexpr uint32_t CFI_QUERY_ADDR = 0x00000055;
+        static constexpr uint32_t CFI_QRY = 0x00000010;
+        static constexpr uint32_t CFI_COMMAND_SET = 0x00000013;
+        static constexpr uint32_t CFI_PRIMARY_TABLE = 0x00000015;
+        static constexpr uint32_t CFI_TYP_WORD_PROGRAM = 0x0000001F;
+        static constexpr uint32_t CFI_MAX_WORD_PROGRAM = 0x00000023;
+        static constexpr uint32_t CFI_DEVICE_SIZE = 0x00000027;
+        static constexpr uint32_t CFI_WRITE_BUFFER_SIZE = 0x0000002A;
+        static constexpr uint32_t CFI_REGION_COUNT = 0x0000002C;
+        static constexpr uint32_t CFI_REGIONS = 0x0000002D;
+        static constexpr uint16_t CFI_AMD_STANDARD = 0x0002;
+        static constexpr uint8_t CFI_TOP_BOOT = 3;
+
+        // worst case for a single word or a single buffer, anything longer means the chip is stuck.
+        // used for chips without datasheet timings, the tick is 1ms so a timeout is never less than 2 ticks
+        static constexpr uint32_t PROGRAM_TIMEOUT_MS = 2;
+        static constexpr uint32_t SECTOR_ERASE_TIMEOUT_MS = 5000;
+        static constexpr uint32_t CHIP_ERASE_TIMEOUT_MS = 600000;
+
+        // sectors queued per erase command, bounds the time to notice a stuck erase
+        static constexpr uint32_t MAX_ERASE_BATCH = 32;
+
+        IFlashBus& mBus;
+        Mode mMode = Mode::WORD;
+        uint32_t mChipSize = 0;
+        FlashInfo mInfo = FlashInfo(0, 0);
+        uint32_t mBufferWords = 0;
+        uint32_t mProgramTimeoutMs = PROGRAM_TIMEOUT_MS;
+        uint32_t mSectorEraseTimeoutMs = SECTOR_ERASE_TIMEOUT_MS;
+        uint32_t mChipEraseTimeoutMs = CHIP_ERASE_TIMEOUT_MS;
+
+        Operation mOperation = Operation::PROGRAM;
+        Status mStatus = Status::IDLE;
+        Stats mStats;
+        const uint8_t *pData = nullptr;
+        uint32_t mBaseAddress = 0;
+        uint32_t mCursor = 0;
+        uint32_t mEnd = 0;
+        bool mInFlight = false;
+        bool mBypassActive = false;
+        uint32_t mPollAddress = 0;
+        uint16_t mPollValue = 0;
+        uint32_t mOpStartTicks = 0;
+        uint32_t mOpTimeoutMs = PROGRAM_TIMEOUT_MS;
+        uint32_t mBeginTicks = 0;
+        uint32_t mEraseCursor = 0;
+        uint32_t mEraseEnd = 0;
+
+        /// @brief get word i of the current data in bus order
+        uint16_t DataWord(uint32_t i) const { return (uint16_t)((pData[i << 1] << 8) | pData[(i << 1) + 1]); }
+
+        /// @brief read a byte wide CFI field, only the low byte of the bus carries data
+        uint8_t CfiByte(uint32_t wordAddress) { return (uint8_t)mBus.FlashRead(wordAddress); }
+
+        static uint32_t CfiTime(uint8_t typicalExponent, uint8_t maxExponent);
+
+        void Unlock();
+        void EnterUnlockBypass();
+        void ExitUnlockBypass();
+        void IssueNext();
+        Status BeginErase(uint32_t wordAddress, uint16_t command, uint32_t timeoutMs);
+        void IssueEraseBatch();
+        PollResult Poll(uint32_t wordAddress, uint16_t expected);
+        Status Finish(Status status);
+    };
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace cartridges{
+
+    /// @brief Word access to a flash chip on the cartridge bus, in the chip's own bit order (DQ0 is bit 0).
+    /// Each cartridge type implements this to wire its control signals, the flash engine only deals in commands.
+    class IFlashBus{
+    public:
+        /// @brief write a word to the flash chip
+        /// @param wordAddress word address, i.e. the byte address divided by 2
+        /// @param data word with DQ15-DQ0 in bits 15-0
+        virtual void FlashWrite(uint32_t wordAddress, uint16_t data) = 0;
+
+        /// @brief read a word from the flash chip
+        /// @param wordAddress word address, i.e. the byte address divided by 2
+        /// @return word with DQ15-DQ0 in bits 15-0
+        virtual uint16_t FlashRead(uint32_t wordAddress) = 0;
+    };
+}
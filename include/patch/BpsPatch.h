@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+#include "patch/Crc32.h"
+#include "patch/IByteSource.h"
+#include "patch/IPatchStream.h"
+#include "patch/PatchReader.h"
+
+namespace patch{
+
+    /// @brief BPS patch applied on the fly. The actions are decoded one at a time as the target is read, copies from
+    /// the target itself are served from a history of the last bytes produced, older bytes are read back from where
+    /// the target was already written. The source, target and patch CRCs of the footer are all checked.
+    class BpsPatch : public IPatchStream{
+    public:
+        /// @param source base ROM
+        /// @param sourceSize size of the base ROM in bytes
+        /// @param patch BPS file
+        /// @param patchSize size of the BPS file in bytes
+        /// @param target the target as produced so far, for copies older than the history, can be null if the
+        /// patch is known not to need it
+        BpsPatch(IByteSource& source, uint32_t sourceSize, IByteSource& patch, uint32_t patchSize, IByteSource* target);
+
+        bool Begin() override;
+        bool Validate() override;
+        uint32_t GetTargetSize() const override { return mTargetSize; }
+        uint32_t Read(uint8_t *buffer, uint32_t size) override;
+        bool Finish() override;
+
+        /// @brief CRC of the target expected by the patch, the zlib CRC-32 and not the hardware one
+        uint32_t GetTargetCrc() const { return mTargetCrc; }
+
+    private:
+
+        enum class Action : uint8_t{
+            SOURCE_READ = 0,
+            TARGET_READ,
+            SOURCE_COPY,
+            TARGET_COPY
+        };
+
+        static constexpr uint8_t HEADER[] = { 'B', 'P', 'S', '1' };
+        static constexpr uint32_t HEADER_SIZE = sizeof(HEADER);
+        // source, target and patch CRC-32, little endian
+        static constexpr uint32_t FOOTER_SIZE = 12;
+        // most target copies are short distance repeats, must be a power of two
+        static constexpr uint32_t HISTORY_SIZE = 4096;
+        static constexpr uint32_t VALIDATE_CHUNK_SIZE = 64;
+
+        IByteSource& mSource;
+        uint32_t mSourceSize;
+        IByteSource& mPatchFile;
+        PatchReader mPatch;
+        IByteSource* pTarget;
+        uint32_t mTargetSize = 0;
+        uint32_t mActionsEnd = 0;
+        uint32_t mSourceCrc = 0;
+        uint32_t mTargetCrc = 0;
+        uint32_t mPatchCrc = 0;
+        Crc32 mOutputCrc;
+
+        uint32_t mOutput = 0;
+        Action mAction = Action::SOURCE_READ;
+        uint32_t mRemaining = 0;
+        uint32_t mSourceOffset = 0;
+        uint32_t mTargetOffset = 0;
+        uint8_t mHistory[HISTORY_SIZE];
+
+        bool ReadNumber(uint32_t& value);
+        bool ReadOffset(uint32_t& offset, uint32_t limit);
+        bool NextAction();
+        bool CopyTarget(uint32_t offset, uint8_t *buffer, uint32_t size);
+        void AppendHistory(const uint8_t *data, uint32_t size);
+        bool Checksum(IByteSource& source, uint32_t size, uint32_t& crc);
+    };
+}
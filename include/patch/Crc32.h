@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace patch{
+
+    constexpr std::array<uint32_t, 256> MakeCrc32Table(){
+        std::array<uint32_t, 256> table = {};
+        for(uint32_t i = 0; i < 256; i++){
+            uint32_t crc = i;
+            for(uint8_t bit = 0; bit < 8; bit++){
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    inline constexpr std::array<uint32_t, 256> CRC32_TABLE = MakeCrc32Table();
+
+    /// @brief Software CRC-32 as used by zlib and the patch formats (reflected, polynomial 0xEDB88320). The hardware
+    /// CRC unit computes the non reflected CRC-32/MPEG2 and can't produce it.
+    class Crc32{
+    public:
+        void Reset() { mCrc = 0xFFFFFFFF; }
+
+        void Update(const uint8_t *data, uint32_t size){
+            for(uint32_t i = 0; i < size; i++){
+                mCrc = CRC32_TABLE[(mCrc ^ data[i]) & 0xFF] ^ (mCrc >> 8);
+            }
+        }
+
+        uint32_t Get() const { return ~mCrc; }
+
+    private:
+        uint32_t mCrc = 0xFFFFFFFF;
+    };
+}
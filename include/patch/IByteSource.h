@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace patch{
+
+    /// @brief Random access to the bytes of a file, or of anything else the patchers need to read from.
+    /// The patchers only ever hold a few bytes at a time so the source can be bigger than the available memory.
+    class IByteSource{
+    public:
+        /// @brief read bytes at an offset
+        /// @param offset offset of the first byte
+        /// @param buffer destination
+        /// @param size number of bytes to read
+        /// @return false if the bytes couldn't all be read
+        virtual bool ReadAt(uint32_t offset, uint8_t *buffer, uint32_t size) = 0;
+    };
+}
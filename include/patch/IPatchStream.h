@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+namespace patch{
+
+    /// @brief A patch applied to a source on the fly, the patched target is produced sequentially by Read() so it can
+    /// be programmed chunk by chunk without ever being stored whole.
+    class IPatchStream{
+    public:
+
+        enum class Error : uint8_t{
+            NONE = 0,
+            BAD_HEADER,
+            BAD_SOURCE_SIZE,
+            BAD_SOURCE_CRC,
+            BAD_PATCH_CRC,
+            BAD_RECORD,
+            UNSORTED_RECORDS,
+            READ_FAILED,
+            BAD_TARGET_CRC
+        };
+
+        virtual ~IPatchStream() {}
+
+        /// @brief Parse the header and check the structure of the patch, the target size is known afterwards
+        /// @return false if the patch can't be applied
+        virtual bool Begin() = 0;
+
+        /// @brief Run the checks that need a full pass over the source or the patch, meant to be called while the
+        /// flash is erasing
+        /// @return false if the source or the patch is corrupt
+        virtual bool Validate() = 0;
+
+        /// @brief Size of the patched target in bytes
+        virtual uint32_t GetTargetSize() const = 0;
+
+        /// @brief Produce the next bytes of the patched target
+        /// @param buffer destination
+        /// @param size number of bytes wanted
+        /// @return number of bytes produced, 0 at the end of the target or on an error
+        virtual uint32_t Read(uint8_t *buffer, uint32_t size) = 0;
+
+        /// @brief Check the whole target was produced and matches the checksum stored in the patch, if any
+        virtual bool Finish() = 0;
+
+        Error GetError() const { return mError; }
+
+    protected:
+        Error mError = Error::NONE;
+
+        bool Fail(Error error){
+            if(mError == Error::NONE){
+                mError = error;
+            }
+            return false;
+        }
+    };
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "patch/IByteSource.h"
+#include "patch/IPatchStream.h"
+#include "patch/PatchReader.h"
+
+namespace patch{
+
+    /// @brief IPS patch applied on the fly. The target is the source overlaid with the records of the patch, only
+    /// the record being applied is kept in memory so the records must be sorted by offset and must not overlap,
+    /// which is the case for patches made by the usual tools. IPS has no checksums, Finish() only checks the length.
+    class IpsPatch : public IPatchStream{
+    public:
+        /// @param source base ROM
+        /// @param sourceSize size of the base ROM in bytes
+        /// @param patch IPS file
+        /// @param patchSize size of the IPS file in bytes
+        IpsPatch(IByteSource& source, uint32_t sourceSize, IByteSource& patch, uint32_t patchSize);
+
+        bool Begin() override;
+        bool Validate() override { return mError == Error::NONE; }
+        uint32_t GetTargetSize() const override { return mTargetSize; }
+        uint32_t Read(uint8_t *buffer, uint32_t size) override;
+        bool Finish() override;
+
+    private:
+
+        struct Record{
+            uint32_t Offset = 0;
+            uint32_t Length = 0;
+            uint32_t DataPosition = 0;
+            bool Rle = false;
+            uint8_t Value = 0;
+        };
+
+        static constexpr uint8_t HEADER[] = { 'P', 'A', 'T', 'C', 'H' };
+        static constexpr uint32_t HEADER_SIZE = sizeof(HEADER);
+        static constexpr uint32_t EOF_MARKER = 0x00454F46;
+
+        IByteSource& mSource;
+        uint32_t mSourceSize;
+        PatchReader mPatch;
+        uint32_t mTargetSize = 0;
+        uint32_t mOutput = 0;
+        Record mRecord;
+        bool mHasRecord = false;
+        uint32_t mApplied = 0;
+
+        bool ReadNumber(uint8_t bytes, uint32_t& value);
+        bool ReadRecord(Record& record, bool& end);
+        bool NextRecord();
+    };
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "patch/IByteSource.h"
+
+namespace patch{
+
+    /// @brief Buffered sequential reader over a patch file, the records are mostly a few bytes each so they are read
+    /// through a small buffer instead of one SD access per field.
+    class PatchReader{
+    public:
+        PatchReader(IByteSource& source, uint32_t size) : mSource(source), mSize(size) {}
+
+        uint32_t Position() const { return mPosition; }
+        uint32_t Size() const { return mSize; }
+        void Seek(uint32_t position) { mPosition = position; }
+
+        /// @brief read the next byte
+        /// @return false at the end of the file or on a read error
+        bool ReadByte(uint8_t& value){
+            if(!Buffered() && !Fill()){
+                return false;
+            }
+            value = mBuffer[mPosition++ - mBufferStart];
+            return true;
+        }
+
+        /// @brief read the next bytes, large reads bypass the buffer
+        /// @return false if the bytes couldn't all be read
+        bool Read(uint8_t *buffer, uint32_t size){
+            while(size != 0){
+                if(Buffered()){
+                    uint32_t count = std::min(size, mBufferStart + mBufferFill - mPosition);
+                    std::memcpy(buffer, mBuffer + (mPosition - mBufferStart), count);
+                    buffer += count;
+                    size -= count;
+                    mPosition += count;
+                }else if(size >= BUFFER_SIZE){
+                    if(!ReadAt(mPosition, buffer, size)){
+                        return false;
+                    }
+                    mPosition += size;
+                    size = 0;
+                }else if(!Fill()){
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// @brief read bytes anywhere in the file without moving the position
+        bool ReadAt(uint32_t position, uint8_t *buffer, uint32_t size){
+            if(position > mSize || size > mSize - position){
+                return false;
+            }
+            return mSource.ReadAt(position, buffer, size);
+        }
+
+    private:
+        static constexpr uint32_t BUFFER_SIZE = 64;
+
+        IByteSource& mSource;
+        uint32_t mSize;
+        uint32_t mPosition = 0;
+        uint32_t mBufferStart = 0;
+        uint32_t mBufferFill = 0;
+        uint8_t mBuffer[BUFFER_SIZE];
+
+        bool Buffered() const { return mPosition >= mBufferStart && mPosition < mBufferStart + mBufferFill; }
+
+        bool Fill(){
+            uint32_t count = mPosition < mSize ? std::min(BUFFER_SIZE, mSize - mPosition) : 0;
+            if(count == 0 || !mSource.ReadAt(mPosition, mBuffer, count)){
+                mBufferFill = 0;
+                return false;
+            }
+            mBufferStart = mPosition;
+            mBufferFill = count;
+            return true;
+        }
+    };
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "cartridges/Array.h"
+
+namespace pipeline{
+
+    /// @brief Fixed set of buffers shared by the pipelines, allocated once so streaming never touches the heap
+    class BufferPool{
+    public:
+        static constexpr uint8_t SIZE = 4;
+
+        /// @brief Take a free buffer
+        /// @return the buffer, or nullptr if they are all in use
+        cartridges::Array* Acquire();
+
+        /// @brief Give a buffer back to the pool
+        void Release(cartridges::Array* array);
+
+        /// @brief Number of free buffers
+        uint8_t Available() const;
+
+    private:
+        // the checksum unit and the word accesses of the cartridges need 32 bit aligned data
+        static_assert(alignof(cartridges::Array) >= 4, "buffers must be 32 bit aligned");
+
+        std::array<cartridges::Array, SIZE> mArrays;
+        uint8_t mInUse = 0;
+    };
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "pipeline/Stage.h"
+
+namespace pipeline{
+
+    /// @brief Swaps the bytes of every 16 bit word in place, between the bus order of a cartridge and the file order,
+    /// or for byte swapped formats and little endian hosts
+    class ByteSwapStage : public Stage{
+    public:
+        const char* GetName() const override { return "swap"; }
+
+        bool Process(Buffer& buffer) override {
+            buffer.pArray->SwapWordBytes();
+            return true;
+        }
+    };
+}
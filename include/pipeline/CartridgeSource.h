@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "pipeline/Stage.h"
+#include "cartridges/Cartridge.h"
+
+namespace pipeline{
+
+    /// @brief Streams a range of a cartridge memory. The data is captured in the order of the bus, a memory with
+    /// IsWordSwapped() needs a ByteSwapStage in front of any stage that wants the file order.
+    class CartridgeSource : public Source{
+    public:
+        enum class Mode : uint8_t{
+            MEMORY,     // ReadMemory()
+            VERIFIED,   // ReadMemoryVerified(), the retries go to the cartridge's verify stats and TakeRetry()
+            IDENTIFY    // Identify(), the memory index is ignored
+        };
+
+        /// @brief Select what to stream, before the pipeline begins
+        /// @param cartridge cartridge to read from
+        /// @param memTypeIndex memory to read from
+        /// @param address first address of the range
+        /// @param length number of bytes to stream
+        /// @param mode how the cartridge is read
+        void Configure(cartridges::Cartridge& cartridge, uint8_t memTypeIndex, uint32_t address, uint32_t length, Mode mode);
+
+        const char* GetName() const override { return "cart"; }
+        bool Process(Buffer& buffer) override;
+        bool IsDone() const override { return mRemaining == 0; }
+
+        /// @brief Address of the next byte to read
+        uint32_t GetAddress() const { return mAddress; }
+
+        /// @brief Are the bytes of each 16 bit word swapped relative to the file
+        bool IsWordSwapped() const { return pCartridge != nullptr && pCartridge->IsBusOrderSwapped(mMemTypeIndex); }
+
+        /// @brief A block that took extra reads to settle in VERIFIED mode
+        struct Retry{
+            uint32_t Address;
+            uint8_t Retries;
+        };
+
+        /// @brief Take the oldest retried block not taken yet, only the last RETRY_QUEUE_SIZE are kept so the queue
+        /// is meant to be drained after every step
+        /// @return false if there is none
+        bool TakeRetry(Retry& retry);
+
+        /// @brief Number of retried blocks dropped because the queue was full
+        uint32_t GetLostRetries() const { return mLostRetries; }
+
+    private:
+        static constexpr uint8_t RETRY_QUEUE_SIZE = 8;
+
+        std::array<Retry, RETRY_QUEUE_SIZE> mRetries;
+        uint8_t mRetryHead = 0;
+        uint8_t mRetryCount = 0;
+        uint32_t mLostRetries = 0;
+
+        cartridges::Cartridge* pCartridge = nullptr;
+        uint8_t mMemTypeIndex = 0;
+        uint32_t mAddress = 0;
+        uint32_t mRemaining = 0;
+        Mode mMode = Mode::MEMORY;
+    };
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include "pipeline/Stage.h"
+#include "cartridges/Cartridge.h"
+
+namespace pipeline{
+
+    /// @brief Runs the stream through the checksum calculator of the cartridge. With a block size, the calculator is
+    /// reset at every block boundary and the checksum of each block is made available once it is complete, block
+    /// checksums are combined with Cartridge::CombineChecksums().
+    class ChecksumStage : public Stage{
+    public:
+        /// @brief Select the calculator and the blocks, before the pipeline begins
+        /// @param cartridge cartridge owning the checksum calculator
+        /// @param blockSize size of the blocks, 0 to checksum the whole stream as one
+        /// @param endAddress address after the last byte of the stream, ends the last block
+        void Configure(cartridges::Cartridge& cartridge, uint32_t blockSize, uint32_t endAddress);
+
+        const char* GetName() const override { return "crc"; }
+        bool Begin() override;
+        bool Process(Buffer& buffer) override;
+
+        /// @brief Did the last buffer complete a block
+        bool IsBlockReady() const { return mBlockReady; }
+        uint32_t GetBlockChecksum() const { return mBlockChecksum; }
+        uint32_t GetBlockBytes() const { return mBlockBytes; }
+        /// @brief Address after the last byte of the completed block
+        uint32_t GetBlockEnd() const { return mBlockEnd; }
+
+    private:
+        cartridges::Cartridge* pCartridge = nullptr;
+        uint32_t mBlockSize = 0;
+        uint32_t mEndAddress = 0;
+        bool mBlockReady = false;
+        uint32_t mBlockChecksum = 0;
+        uint32_t mBlockBytes = 0;
+        uint32_t mBlockEnd = 0;
+        uint32_t mPendingBytes = 0;
+    };
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "pipeline/Stage.h"
+
+namespace pipeline{
+
+    /// @brief Discards the stream, for operations that only need what the stages compute, i.e. a checksum
+    class NullSink : public Stage{
+    public:
+        const char* GetName() const override { return "null"; }
+        bool Process(Buffer& buffer) override { return true; }
+    };
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "pipeline/Stage.h"
+#include "services/PackedDumpWriter.h"
+#include "services/SdBlockWriter.h"
+
+namespace pipeline{
+
+    /// @brief Compresses the stream into a packed dump on an SD file, both writers must have been started with
+    /// Begin() and are finished with the pipeline. The header still needs PackedDumpWriter::Finish() afterwards.
+    class PackedFileSink : public Stage{
+    public:
+        PackedFileSink(umd::PackedDumpWriter& packer, umd::SdBlockWriter& writer) : mPacker(packer), mWriter(writer) {}
+
+        const char* GetName() const override { return "pack"; }
+        bool Process(Buffer& buffer) override { return mPacker.Write(buffer.pArray->Data(), buffer.pArray->AvailableSize()); }
+
+        bool Finish() override {
+            // the last block goes out before the writer is finished, the writer is finished regardless
+            bool result = mPacker.End();
+            return mWriter.Finish() && result;
+        }
+
+    private:
+        umd::PackedDumpWriter& mPacker;
+        umd::SdBlockWriter& mWriter;
+    };
+}
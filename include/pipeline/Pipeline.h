@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "pipeline/Stage.h"
+#include "pipeline/BufferPool.h"
+
+namespace pipeline{
+
+    /// @brief A source and the stages its buffers go through, e.g. cartridge -> checksum -> SD file. Operations drive
+    /// it one buffer at a time with Step() so they can show progress and act between buffers.
+    class Pipeline{
+    public:
+        static constexpr uint8_t MAX_STAGES = 6;
+
+        Pipeline(BufferPool& pool) : mPool(pool) {}
+
+        /// @brief Start assembling a new pipeline from a source
+        void Reset(Source& source);
+
+        /// @brief Append a stage after the ones already added
+        /// @return false if the pipeline is full
+        bool Add(Stage& stage);
+
+        /// @brief Begin every stage and reset their throughput accounting
+        bool Begin();
+
+        /// @brief Move the next buffer from the source through every stage
+        /// @return false if a stage failed or no buffer was free
+        bool Step();
+
+        /// @brief Has the source produced the whole stream
+        bool IsDone() const { return pSource == nullptr || pSource->IsDone(); }
+
+        /// @brief Finish every stage, whether the run succeeded or not
+        /// @return false if a stage failed to finish
+        bool Finish();
+
+        /// @brief Step until the source is done and finish
+        bool Run();
+
+        /// @brief Stage that spent the most time per byte in the last run, where the pipeline is bound
+        const Stage* GetSlowestStage() const;
+
+    private:
+        BufferPool& mPool;
+        Source* pSource = nullptr;
+        std::array<Stage*, MAX_STAGES> mStages;
+        uint8_t mStageCount = 0;
+
+        // the source counts as the first stage
+        Stage& StageAt(uint8_t i) const { return i == 0 ? *pSource : *mStages[i - 1]; }
+    };
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "pipeline/Stage.h"
+#include "services/SdBlockWriter.h"
+
+namespace pipeline{
+
+    /// @brief Writes the stream to an SD file through an SdBlockWriter, the writer must have been started with
+    /// Begin() and is finished with the pipeline
+    class SdFileSink : public Stage{
+    public:
+        SdFileSink(umd::SdBlockWriter& writer) : mWriter(writer) {}
+
+        const char* GetName() const override { return "sd"; }
+        bool Process(Buffer& buffer) override { return mWriter.Write(buffer.pArray->Data(), buffer.pArray->AvailableSize()); }
+        bool Finish() override { return mWriter.Finish(); }
+
+    private:
+        umd::SdBlockWriter& mWriter;
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "pipeline/Stage.h"
+
+namespace pipeline{
+
+    /// @brief Looks for a set of strings in the stream, i.e. library version strings telling the save type or the
+    /// marker of a mapper, so they come out of the dump or identify pass without another read of the ROM. All the
+    /// patterns are matched in one pass with an Aho-Corasick automaton built by Configure(), the state is carried
+    /// from one buffer to the next so a string split across buffers is found. Transitions from the root go through a
+    /// table, most of a ROM never leaves it.
+    class SignatureScanStage : public Stage{
+    public:
+        static constexpr uint8_t MAX_PATTERNS = 16;
+        static constexpr uint16_t MAX_STATES = 256;
+
+        /// @brief Where a pattern was found
+        struct Hit{
+            uint32_t Count = 0;
+            // address of the first byte of the first occurrence
+            uint32_t FirstAddress = 0;
+        };
+
+        /// @brief Build the automaton, before the pipeline begins
+        /// @param patterns strings to look for, must outlive the scan
+        /// @return false if there are too many patterns or they don't fit in MAX_STATES
+        bool Configure(const std::vector<const char *>& patterns);
+
+        const char* GetName() const override { return "scan"; }
+        bool Begin() override;
+        bool Process(Buffer& buffer) override;
+
+        uint8_t GetPatternCount() const { return mPatternCount; }
+        const char* GetPattern(uint8_t index) const { return mPatterns[index]; }
+        const Hit& GetHit(uint8_t index) const { return mHits[index]; }
+
+        /// @brief Number of patterns found at least once
+        uint8_t GetFoundCount() const;
+
+    private:
+        static constexpr uint16_t ROOT = 0;
+
+        struct Node{
+            uint16_t FirstChild;
+            uint16_t NextSibling;
+            // longest proper suffix of this node that is also in the trie
+            uint16_t Fail;
+            // patterns ending here, including through the fail links
+            uint16_t Output;
+            uint8_t Char;
+        };
+
+        std::array<Node, MAX_STATES> mNodes;
+        std::array<uint16_t, 256> mRootNext;
+        std::array<const char *, MAX_PATTERNS> mPatterns;
+        std::array<uint8_t, MAX_PATTERNS> mLengths;
+        std::array<Hit, MAX_PATTERNS> mHits;
+        uint16_t mNodeCount = 1;
+        uint8_t mPatternCount = 0;
+        uint16_t mState = ROOT;
+
+        uint16_t Child(uint16_t node, uint8_t c) const;
+        void Record(uint16_t node, uint32_t endAddress);
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include "cartridges/Array.h"
+
+namespace pipeline{
+
+    /// @brief A buffer moving down a pipeline. It belongs to the stage working on it and is handed on by reference,
+    /// the data is never copied from one stage to the next.
+    struct Buffer{
+        cartridges::Array* pArray = nullptr;
+        // address of the first byte in the memory being streamed
+        uint32_t Address = 0;
+    };
+
+    /// @brief Throughput accounting of a stage, only the time spent in the stage counts
+    struct StageStats{
+        uint32_t Bytes = 0;
+        uint32_t Micros = 0;
+
+        uint32_t BytesPerSecond() const {
+            return Micros == 0 ? 0 : (uint32_t)(((uint64_t)Bytes * 1000000) / Micros);
+        }
+    };
+
+    /// @brief One step of a pipeline. The source fills the buffers, transforms work on them in place and sinks
+    /// consume them, a pipeline is assembled from a source followed by any number of stages.
+    class Stage{
+    public:
+        virtual ~Stage() {}
+
+        /// @brief Name for the throughput report
+        virtual const char* GetName() const = 0;
+
+        /// @brief Prepare for a run, once the stage is configured
+        virtual bool Begin() { return true; }
+
+        /// @brief Work on the next buffer, buffers arrive in stream order
+        /// @return false to stop the pipeline
+        virtual bool Process(Buffer& buffer) = 0;
+
+        /// @brief Complete the run, called even when the run failed so sinks can release what they hold
+        /// @return false if the stage failed
+        virtual bool Finish() { return true; }
+
+        const StageStats& GetStats() const { return mStats; }
+        void ResetStats() { mStats = StageStats(); }
+        void Account(uint32_t bytes, uint32_t micros) { mStats.Bytes += bytes; mStats.Micros += micros; }
+
+    private:
+        StageStats mStats;
+    };
+
+    /// @brief First stage of a pipeline, Process() fills the buffer with the next data of the stream
+    class Source : public Stage{
+    public:
+        /// @brief Has the whole stream been produced
+        virtual bool IsDone() const = 0;
+    };
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "pipeline/Stage.h"
+
+namespace pipeline{
+
+    /// @brief Fans every buffer out to two sinks, i.e. an SD file and a USB stream. Each branch gets the buffer in
+    /// turn and must be done with it before the next one is read, so the slower sink sets the pace and the cartridge
+    /// is read once. The branches keep their own throughput accounting.
+    class TeeSink : public Stage{
+    public:
+        TeeSink(Stage& first, Stage& second) : mFirst(first), mSecond(second) {}
+
+        const char* GetName() const override { return "tee"; }
+        bool Begin() override;
+        bool Process(Buffer& buffer) override;
+        bool Finish() override;
+
+        /// @brief Branch that spent the most time, where the tee is bound
+        const Stage& GetSlowerBranch() const;
+
+    private:
+        Stage& mFirst;
+        Stage& mSecond;
+
+        static bool ProcessBranch(Stage& branch, Buffer& buffer);
+    };
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include <cstdint>
+#include <string>
+#include "pipeline/Stage.h"
+
+namespace pipeline{
+
+    /// @brief Streams the data to the host over the USB CDC port. A transfer is framed by text lines so a terminal or
+    /// a script can pick it up: "UMD DUMP <name> <size>", the raw bytes, then "UMD END <crc>" or "UMD FAIL".
+    /// Writes wait for room in the CDC buffer, a host that stops reading stalls the pipeline until WRITE_TIMEOUT_MS.
+    /// The transfer doesn't begin without a host on the port.
+    class UsbSink : public Stage{
+    public:
+        static constexpr uint32_t WRITE_TIMEOUT_MS = 2000;
+
+        UsbSink(USBSerial& port) : mPort(port) {}
+
+        /// @brief Describe the transfer, before the pipeline begins
+        void Configure(const std::string& name, uint32_t size);
+
+        const char* GetName() const override { return "usb"; }
+        bool Begin() override;
+        bool Process(Buffer& buffer) override;
+
+        /// @brief Close the transfer once the result is known
+        void SendResult(bool success, uint32_t checksum);
+
+    private:
+        USBSerial& mPort;
+        std::string mName;
+        uint32_t mSize = 0;
+    };
+}
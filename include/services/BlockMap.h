@@ -0,0 +1,68 @@
+#pragma once
+
+#include <STM32SD.h>
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace umd{
+
+    /// @brief Checksums of the 4KB blocks of a memory, so a cartridge can be checked against a dump or a known good
+    /// ROM without the data, and a bad dump narrowed down to the blocks that differ. Dumps write one alongside the
+    /// file as <name>.crc, the database carries them as <checksum>.crc next to <checksum>.txt.
+    /// The file is little endian, a Header followed by one checksum per block, computed from a reset of the checksum
+    /// calculator like the whole memory checksum.
+    class BlockMap{
+    public:
+        static constexpr uint32_t BLOCK_SIZE = 0x1000;
+
+        struct Header{
+            uint32_t Magic;
+            uint32_t BlockSize;
+            uint32_t TotalSize;
+            // checksum of the whole memory, 0 while the map is incomplete
+            uint32_t Checksum;
+        };
+
+        /// @brief Start writing a map, or continue the map of an interrupted dump
+        /// @param path path of the map
+        /// @param totalSize size of the memory
+        /// @param resumeBlocks number of blocks already in the map to keep, 0 starts a new map
+        /// @return false if the file can't be written, or doesn't match when resuming
+        bool Create(const std::string& path, uint32_t totalSize, uint32_t resumeBlocks = 0);
+
+        /// @brief Append the checksum of the next block
+        bool Add(uint32_t checksum);
+
+        /// @brief Write the checksums added so far to the card
+        bool Sync();
+
+        /// @brief Complete the map with the checksum of the whole memory and close it
+        bool Finish(uint32_t checksum);
+
+        /// @brief Open a map for Get()
+        /// @return false if the file is missing or not a block map
+        bool Open(const std::string& path);
+
+        /// @brief Get the checksum of a block, reading in order is buffered
+        bool Get(uint32_t block, uint32_t& checksum);
+
+        /// @brief Close the map, an incomplete map being written stays incomplete
+        void Close();
+
+        const Header& GetHeader() const { return mHeader; }
+        uint32_t GetBlockCount() const { return (mHeader.TotalSize + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+
+    private:
+        static constexpr uint32_t MAGIC = 0x4D424D55; // "UMBM"
+        static constexpr uint32_t BUFFER_ENTRIES = 64;
+
+        File mFile;
+        Header mHeader = {};
+        std::array<uint32_t, BUFFER_ENTRIES> mBuffer;
+        // first block in the buffer and number of valid entries
+        uint32_t mBufferBlock = 0;
+        uint32_t mBufferCount = 0;
+        bool mWriting = false;
+    };
+}
@@ -12,4 +12,15 @@ public:
     void Reset() override;
     uint32_t Accumulate(uint32_t pBuffer[], uint32_t length) override;
     uint32_t Get() override;
+    uint32_t Combine(uint32_t crcA, uint32_t crcB, uint32_t lengthB) override;
+
+private:
+    static constexpr uint32_t CRC32_POLY = 0x04C11DB7;
+    static constexpr uint32_t CRC32_INIT = 0xFFFFFFFF;
+
+    /// @brief multiply two polynomials modulo CRC32_POLY, bit 31 is the x^31 coefficient
+    static uint32_t MultiplyModP(uint32_t a, uint32_t b);
+
+    /// @brief compute x^(8*length) modulo CRC32_POLY
+    static uint32_t XPow8N(uint32_t length);
 };
\ No newline at end of file
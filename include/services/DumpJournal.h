@@ -0,0 +1,54 @@
+#pragma once
+
+#include <STM32SD.h>
+#include <cstdint>
+#include <string>
+
+namespace umd{
+
+    /// @brief Journal of a dump in progress, so a dump interrupted by a power loss or a cartridge bump can continue
+    /// from the last committed block. The record holds the target file, the size, the committed offset and the
+    /// checksums needed to rebuild the final checksum without reading the committed part again.
+    class DumpJournal{
+    public:
+        // dumps are committed in blocks this size, a multiple of the SD writer chunks
+        static constexpr uint32_t BLOCK_SIZE = 0x10000;
+        static constexpr uint8_t MAX_FILE_NAME = 64;
+
+        struct Record{
+            uint32_t Magic;
+            uint8_t MemTypeIndex;
+            uint8_t Reserved[3];
+            uint32_t TotalSize;
+            // bytes of the file known to be written
+            uint32_t Committed;
+            // checksum of the committed bytes, and of the last committed block to check the file before resuming
+            uint32_t Checksum;
+            uint32_t LastBlockChecksum;
+            char FileName[MAX_FILE_NAME];
+            // checksum of the fields above, a torn write of the record is ignored
+            uint32_t RecordCrc;
+        };
+
+        /// @brief Read the journal left by an interrupted dump
+        /// @return false if there is no journal or it is corrupt
+        bool Load(const std::string& path, Record& record);
+
+        /// @brief Open the journal for the commits of a dump
+        bool Begin(const std::string& path);
+
+        /// @brief Durably store the progress of the dump, the data up to record.Committed must be on the card
+        bool Commit(Record& record);
+
+        /// @brief Close the journal, it is deleted once the dump is complete and kept otherwise to resume it
+        void End(bool completed);
+
+    private:
+        static constexpr uint32_t MAGIC = 0x4A444D55; // "UMDJ"
+
+        File mFile;
+        std::string mPath;
+
+        static uint32_t RecordCrc(const Record& record);
+    };
+}
@@ -9,4 +9,11 @@ public:
     // TODO return an array of uint32_t to allow for larger hash results
     virtual uint32_t Accumulate(uint32_t pBuffer[], uint32_t length) = 0;
     virtual uint32_t Get() = 0;
-};
\ No newline at end of file
+
+    /// @brief Combine two checksums computed independently from a reset into the checksum of the concatenated data
+    /// @param checksumA checksum of the first block A
+    /// @param checksumB checksum of the second block B
+    /// @param lengthB length of block B in bytes
+    /// @return checksum of A followed by B
+    virtual uint32_t Combine(uint32_t checksumA, uint32_t checksumB, uint32_t lengthB) = 0;
+};
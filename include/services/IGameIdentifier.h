@@ -18,4 +18,9 @@ public:
     /// @param gameId 
     /// @return 
     virtual std::string GetGameName(const std::string& gameId) = 0;
+
+    /// @brief Get the path of the block checksums of a known good game, see umd::BlockMap
+    /// @param gameId 
+    /// @return the path, or empty if the database has no block map for the game
+    virtual std::string GetBlockMapPath(const std::string& gameId) = 0;
 };
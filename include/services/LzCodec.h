@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace umd{
+
+    /// @brief Greedy compressor producing the LZ4 block format, small enough for the dump path: a 2KB hash table
+    /// and no window beyond the block being compressed. Sequences are a token with the literal and match lengths, the
+    /// literals, and a 16 bit little endian offset, the last 5 bytes of a block are always literals.
+    class LzCodec{
+    public:
+        // blocks are compressed independently, offsets stay well within 16 bits
+        static constexpr uint32_t MAX_BLOCK_SIZE = 0x1000;
+
+        /// @brief Compress a block
+        /// @param src data to compress, at most MAX_BLOCK_SIZE bytes
+        /// @param size number of bytes to compress
+        /// @param dst compressed data
+        /// @param capacity size of dst, compression gives up once the output would not fit
+        /// @return size of the compressed data, 0 if it didn't fit and the block should be stored as is
+        uint32_t Compress(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t capacity);
+
+    private:
+        static constexpr uint32_t HASH_BITS = 10;
+        static constexpr uint32_t MIN_MATCH = 4;
+        static constexpr uint32_t LAST_LITERALS = 5;
+        // a match can't start in the last 12 bytes of a block
+        static constexpr uint32_t MATCH_FIND_LIMIT = 12;
+
+        std::array<uint16_t, 1 << HASH_BITS> mTable;
+
+        static uint32_t Read32(const uint8_t *p);
+        static uint32_t Hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - HASH_BITS); }
+
+        /// @brief Append a literal run and a match, or only literals if matchLength is 0
+        /// @return false if the sequence doesn't fit
+        static bool Emit(const uint8_t *literals, uint32_t literalLength, uint32_t offset, uint32_t matchLength, uint8_t *&op, const uint8_t *end);
+    };
+}
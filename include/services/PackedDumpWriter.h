@@ -0,0 +1,69 @@
+#pragma once
+
+#include <STM32SD.h>
+#include <array>
+#include <cstdint>
+
+#include "services/LzCodec.h"
+#include "services/SdBlockWriter.h"
+
+namespace umd{
+
+    /// @brief Compression stage between the cartridge reads and the SD writer, for dumps with large padded regions.
+    /// The container is little endian: a Header, then one entry per 4KB block of the memory, a 32 bit size with
+    /// STORED_FLAG set for a block kept as is, followed by the LZ4 block or the raw data. scripts/UnpackDump.py
+    /// restores the .bin and checks it against the checksum in the header.
+    class PackedDumpWriter{
+    public:
+        static constexpr uint32_t BLOCK_SIZE = LzCodec::MAX_BLOCK_SIZE;
+        static constexpr uint32_t STORED_FLAG = 0x80000000;
+
+        struct Header{
+            uint32_t Magic;
+            uint16_t Version;
+            uint16_t Reserved;
+            uint32_t BlockSize;
+            uint32_t TotalSize;
+            // checksum of the uncompressed data, as computed by the checksum calculator
+            uint32_t Checksum;
+        };
+
+        /// @brief Largest file a memory can produce, for the preallocation
+        static uint32_t MaxFileSize(uint32_t totalSize){
+            return sizeof(Header) + ((totalSize + BLOCK_SIZE - 1) / BLOCK_SIZE) * (sizeof(uint32_t) + BLOCK_SIZE);
+        }
+
+        /// @brief Start a container, the header is completed by Finish()
+        /// @param writer SD writer of the file, already started with Begin()
+        /// @param totalSize size of the uncompressed data
+        bool Begin(SdBlockWriter& writer, uint32_t totalSize);
+
+        /// @brief Add uncompressed data, every full block is compressed and passed to the writer
+        bool Write(const uint8_t *data, uint32_t size);
+
+        /// @brief Compress the last partial block, must be called before the writer is finished
+        bool End();
+
+        /// @brief Write the completed header once the writer is finished
+        /// @param file the file of the writer, still open
+        /// @param checksum checksum of the uncompressed data
+        bool Finish(File& file, uint32_t checksum);
+
+        /// @brief Size of the compressed output so far, header included
+        uint32_t GetPackedSize() const { return mPackedSize; }
+
+    private:
+        static constexpr uint32_t MAGIC = 0x5A444D55; // "UMDZ"
+        static constexpr uint16_t VERSION = 1;
+
+        LzCodec mCodec;
+        SdBlockWriter* pWriter = nullptr;
+        Header mHeader = {};
+        std::array<uint8_t, BLOCK_SIZE> mBlock;
+        std::array<uint8_t, BLOCK_SIZE> mPacked;
+        uint32_t mFill = 0;
+        uint32_t mPackedSize = 0;
+
+        bool PackBlock();
+    };
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <STM32SD.h>
+#include <cstdint>
+
+#include "services/SdDmaSink.h"
+
+namespace umd{
+
+    /// @brief Sequential writer for a file of known size on the SD card. The file is preallocated as one contiguous
+    /// run of clusters so FatFs doesn't walk and extend the FAT while writing, and the data is staged into chunks
+    /// aligned to the clusters so every write goes out as a single multi-block transfer. With a DMA sink, the chunk
+    /// is split in two halves which are sent straight to the sectors of the contiguous file while the other half fills.
+    class SdBlockWriter{
+    public:
+        // largest chunk staged before writing, the chunk is the cluster size when the cluster is smaller
+        static constexpr uint32_t MAX_CHUNK_SIZE = 8192;
+        // halves of the chunk in flight with a DMA sink
+        static constexpr uint8_t DMA_SLOTS = 2;
+
+        /// @brief Prepare a file opened for writing, its previous content is discarded
+        /// @param file file opened with FILE_WRITE, must stay open until Finish()
+        /// @param size number of bytes that will be written
+        /// @param sink optional DMA sink, only used if the file could be preallocated contiguously
+        /// @param resumeOffset continue a file left by a previous Begin() from this offset instead, must be a
+        /// multiple of MAX_CHUNK_SIZE
+        /// @return false if the file can't be written
+        bool Begin(File& file, uint32_t size, SdDmaSink* sink = nullptr, uint32_t resumeOffset = 0);
+
+        /// @brief Append data, the full chunks are written as they fill up
+        /// @return false on a write error
+        bool Write(const uint8_t *data, uint32_t size);
+
+        /// @brief Wait until everything written so far is on the card, the allocation already is since Begin()
+        /// @return false on a write error
+        bool Sync();
+
+        /// @brief Write the last partial chunk and trim the preallocation to what was written
+        /// @return false on a write error
+        bool Finish();
+
+        /// @brief Was the file preallocated as a single run of clusters
+        bool IsContiguous() const { return mContiguous; }
+
+        /// @brief Are the writes going through the DMA sink
+        bool IsAsync() const { return pSink != nullptr; }
+
+    private:
+        File* pFile = nullptr;
+        SdDmaSink* pSink = nullptr;
+        uint8_t mSlot = 0;
+        uint8_t mSlotsInFlight = 0;
+        uint32_t mChunkSize = MAX_CHUNK_SIZE;
+        uint32_t mFill = 0;
+        uint32_t mSize = 0;
+        uint32_t mWritten = 0;
+        bool mContiguous = false;
+        bool mError = false;
+        alignas(4) uint8_t mChunk[MAX_CHUNK_SIZE];
+
+        bool Flush();
+        bool SubmitSlot(uint32_t size);
+        bool ReclaimSlots(uint8_t maxInFlight);
+        uint8_t *Slot() { return mChunk + mSlot * (mChunkSize / DMA_SLOTS); }
+    };
+}
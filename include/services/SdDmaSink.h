@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <stm32f4xx_hal.h>
+
+namespace umd{
+
+    /// @brief Writes buffers to a range of SD sectors with SDIO DMA so the CPU is free while they are transferred.
+    /// Buffers are queued with Submit() and given back by Reclaim() once their transfer completed, completion is
+    /// signalled by the SDIO interrupt. Service() starts the next queued transfer once the card is done programming
+    /// the previous one. FatFs must not access the card while transfers are pending.
+    class SdDmaSink{
+    public:
+        static constexpr uint8_t QUEUE_DEPTH = 4;
+        static constexpr uint32_t SECTOR_SIZE = 512;
+
+        enum class Status : uint8_t{
+            IDLE = 0,
+            BUSY,
+            ERROR
+        };
+
+        /// @brief Set up the DMA stream for SDIO transmit and start a new range of sectors
+        /// @param firstSector first sector to write
+        /// @param sectorCount number of sectors in the range, submits past it fail
+        /// @return false if the DMA stream can't be set up
+        bool Begin(uint32_t firstSector, uint32_t sectorCount);
+
+        /// @brief Queue a buffer for the next sectors of the range
+        /// @param buffer word aligned data, must not be modified until Reclaim() gives it back
+        /// @param size number of bytes, a multiple of the sector size
+        /// @return false if the queue is full, the range is exceeded or a transfer failed
+        bool Submit(const uint8_t *buffer, uint32_t size);
+
+        /// @brief Is there no room left in the queue
+        bool IsFull() const { return mSubmitted - mReclaimed == QUEUE_DEPTH; }
+
+        /// @brief Start the next transfer if the card is ready, never blocks
+        /// @return BUSY while transfers are pending, IDLE once all are done, or ERROR
+        Status Service();
+
+        /// @brief Give back the oldest buffer whose transfer completed
+        /// @return the buffer, or nullptr if none completed yet
+        const uint8_t* Reclaim();
+
+        /// @brief Wait for all queued transfers and release the DMA stream
+        /// @return false if any transfer failed
+        bool Finish();
+
+        /// @brief Called from the HAL callbacks in interrupt context
+        void OnTransferComplete() { mCompleted = mCompleted + 1; }
+        void OnTransferError() { mError = true; }
+
+    private:
+
+        struct Entry{
+            const uint8_t *Buffer;
+            uint32_t Sector;
+            uint32_t Sectors;
+        };
+
+        // a multi-block write of a few KB takes a few ms, anything this long means the card is gone
+        static constexpr uint32_t TRANSFER_TIMEOUT_MS = 500;
+        static constexpr uint32_t IRQ_PRIORITY = 1;
+
+        Entry mQueue[QUEUE_DEPTH];
+        // free running counters, the queue index is the counter modulo the depth
+        uint32_t mSubmitted = 0;
+        uint32_t mIssued = 0;
+        volatile uint32_t mCompleted = 0;
+        uint32_t mReclaimed = 0;
+        volatile bool mError = false;
+        uint32_t mNextSector = 0;
+        uint32_t mEndSector = 0;
+        uint32_t mIssueTicks = 0;
+        bool mActive = false;
+        DMA_HandleTypeDef mDmaTx = {};
+    };
+}
@@ -10,6 +10,7 @@ namespace umd{
         bool Init(const std::string& basePath) override;
         bool GameExists(const std::string& gameId) override;
         std::string GetGameName(const std::string& gameId) override;
+        std::string GetBlockMapPath(const std::string& gameId) override;
 
     private:
         std::string mBasePath = "/UMD/";
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <STM32SD.h>
+#include <cstdint>
+#include <string>
+
+namespace umd{
+
+    /// @brief Picks the fastest SDIO clock and bus width the card handles reliably. Each setting is tried from the
+    /// slowest up with a write and read back of a scratch file, the result is stored per card CID so it is only
+    /// measured once. CRC or FIFO errors during operation drop to the next slower setting. The HAL clears the error
+    /// code at the start of every transfer, so errors are latched by LatchErrors() as each transfer ends.
+    class SdTuner{
+    public:
+
+        struct Setting{
+            uint8_t ClockDiv;
+            bool WideBus;
+        };
+
+        /// @brief Apply the setting stored for the card, or measure one and store it
+        /// @param scratchPath file used for the test, deleted afterwards
+        /// @param settingsPath file holding the settings of the known cards
+        /// @return the setting in use
+        Setting Tune(const std::string& scratchPath, const std::string& settingsPath);
+
+        /// @brief Consume the errors latched since the last check, on a CRC or FIFO error fall back to the next
+        /// slower setting and store it
+        /// @return true if the setting changed
+        bool CheckErrors();
+
+        /// @brief Record the link errors of a transfer that just ended, from the HAL callbacks and the wrappers of
+        /// the blocking SD reads and writes. Safe in interrupt context.
+        static void LatchErrors(uint32_t errorCode) { sLinkErrors |= errorCode & LINK_ERRORS; }
+
+        Setting GetSetting() const { return mSetting; }
+
+        /// @brief SDIO clock in kHz for the setting, from the 48MHz SDIO kernel clock
+        static uint32_t ClockKHz(const Setting& setting) { return 48000 / (setting.ClockDiv + 2); }
+
+    private:
+
+        static constexpr uint32_t LINK_ERRORS = HAL_SD_ERROR_DATA_CRC_FAIL | HAL_SD_ERROR_TX_UNDERRUN | HAL_SD_ERROR_RX_OVERRUN;
+        static volatile uint32_t sLinkErrors;
+
+        // SDIO_CK = 48MHz / (CLKDIV + 2), from 4.8MHz to 24MHz, tried in this order
+        static constexpr uint8_t CLOCK_DIVS[] = { 8, 4, 2, 1, 0 };
+        static constexpr uint8_t CLOCK_DIV_COUNT = sizeof(CLOCK_DIVS);
+        static constexpr Setting SAFE_SETTING = { 8, false };
+        static constexpr uint32_t TEST_SIZE = 4096;
+        static constexpr uint8_t TEST_PASSES = 4;
+
+        Setting mSetting = SAFE_SETTING;
+        std::string mSettingsPath;
+        alignas(4) uint8_t mBuffer[TEST_SIZE];
+
+        bool Apply(const Setting& setting);
+        bool Test(const std::string& scratchPath, uint8_t seed);
+        bool Load(Setting& setting);
+        void Save();
+        std::string CardId() const;
+        static bool ReadLine(File& file, std::string& line);
+    };
+}
@@ -93,6 +93,12 @@ public:
     void SetProgressBarVisibility(bool visible);
     void SetProgressBarSize(int width);
     void UpdateProgressBar(uint32_t progress, uint32_t max, bool showMillis = false);
+
+    /// @brief update the progress bar and show the transfer rate instead of the percentage
+    /// @param progress current progress
+    /// @param max progress when complete
+    /// @param bytesPerSecond transfer rate to display
+    void UpdateProgressBarRate(uint32_t progress, uint32_t max, uint32_t bytesPerSecond);
     void SetProgressBarComplete(uint32_t millis);
 
     void Redraw(void);
@@ -122,9 +128,11 @@ private:
         uint32_t Progress = 0;
         uint32_t Max = 100;
         uint32_t Millis = 0;
+        uint32_t BytesPerSecond = 0;
         float Percent = 0.0f;
         bool ShowPercent = true;
         bool ShowMillis = false;
+        bool ShowRate = false;
     } mProgressBar;
 
     bool mRedrawScreen;
@@ -37,6 +37,18 @@ def calculate_crc32(filename):
     print(result)
     return result
 
+# Block map of the ROM, matches umd::BlockMap: a header then the CRC of every 4KB block, all little endian
+BLOCK_MAP_MAGIC = 0x4D424D55
+BLOCK_MAP_BLOCK_SIZE = 0x1000
+
+def create_block_map(filename, crc, output_directory):
+    buf = reverse_endianness(open(filename, 'rb').read())
+    crcStm32 = Crc(32, 0x04C11DB7, 0xFFFFFFFF, 0, False, False, False)
+    with open(os.path.join(output_directory, f"{crc}.crc"), 'wb') as f:
+        f.write(struct.pack('<IIII', BLOCK_MAP_MAGIC, BLOCK_MAP_BLOCK_SIZE, len(buf), int(crc, 16)))
+        for i in range(0, len(buf), BLOCK_MAP_BLOCK_SIZE):
+            f.write(struct.pack('<I', crcStm32.calc(buf[i:i + BLOCK_MAP_BLOCK_SIZE])))
+
 # Create a file with the CRC32 checksum as the filename and the ROM name as the contents
 def create_file(crc, rom_name, output_directory):
     with open(os.path.join(output_directory, f"{crc}.txt"), 'w') as f:
@@ -49,5 +61,6 @@ def process_directory(directory, output_directory):
             print("processing", rom_name)
             crc = calculate_crc32(filename)
             create_file(crc, rom_name, output_directory)
+            create_block_map(filename, crc, output_directory)
 
 process_directory('./Genesis', '../SD/UMD/Genesis')
\ No newline at end of file
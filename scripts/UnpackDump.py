@@ -0,0 +1,107 @@
+import sys
+import struct
+
+# Restores a .bin from a packed dump written by umd::PackedDumpWriter and checks the checksum in its header
+# usage: python UnpackDump.py dump.umz [dump.bin]
+
+PACKED_MAGIC = 0x5A444D55
+STORED_FLAG = 0x80000000
+
+# CRC32 as computed by the STM32 CRC unit, over little endian 32 bit words
+def make_crc_table(poly=0x04C11DB7):
+    table = []
+    for i in range(256):
+        crc = i << 24
+        for _ in range(8):
+            crc = ((crc << 1) ^ poly) if (crc & 0x80000000) else (crc << 1)
+        table.append(crc & 0xFFFFFFFF)
+    return table
+
+CRC_TABLE = make_crc_table()
+
+def crc32_stm32(data):
+    crc = 0xFFFFFFFF
+    # the unit only sees whole words, each word is fed most significant byte first
+    for i in range(0, len(data) - len(data) % 4, 4):
+        for b in (data[i + 3], data[i + 2], data[i + 1], data[i]):
+            crc = ((crc << 8) & 0xFFFFFFFF) ^ CRC_TABLE[(crc >> 24) ^ b]
+    return crc
+
+# LZ4 block format decoder
+def lz4_decode_block(src, size):
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        length = token >> 4
+        if length == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        out += src[i:i + length]
+        i += length
+        if i >= len(src):
+            break
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        length = token & 0x0F
+        if length == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        length += 4
+        start = len(out) - offset
+        if offset == 0 or start < 0:
+            raise ValueError("bad match offset")
+        # matches may overlap the bytes they produce
+        for k in range(length):
+            out.append(out[start + k])
+    if len(out) != size:
+        raise ValueError("block decodes to %d bytes, expected %d" % (len(out), size))
+    return bytes(out)
+
+def unpack(data):
+    magic, version, _, block_size, total_size, checksum = struct.unpack_from('<IHHIII', data, 0)
+    if magic != PACKED_MAGIC or version != 1:
+        raise ValueError("not a packed dump")
+
+    out = bytearray()
+    pos = struct.calcsize('<IHHIII')
+    while len(out) < total_size:
+        entry, = struct.unpack_from('<I', data, pos)
+        pos += 4
+        size = min(block_size, total_size - len(out))
+        if entry & STORED_FLAG:
+            length = entry & ~STORED_FLAG
+            out += data[pos:pos + length]
+        else:
+            length = entry
+            out += lz4_decode_block(data[pos:pos + length], size)
+        pos += length
+
+    return bytes(out), checksum
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print("usage: python UnpackDump.py dump.umz [dump.bin]")
+        sys.exit(1)
+
+    source = sys.argv[1]
+    target = sys.argv[2] if len(sys.argv) > 2 else source.rsplit('.', 1)[0] + '.bin'
+    data, checksum = unpack(open(source, 'rb').read())
+    crc = crc32_stm32(data)
+
+    with open(target, 'wb') as f:
+        f.write(data)
+
+    print("%s: %d bytes, CRC %08X" % (target, len(data), crc))
+    if crc != checksum:
+        print("checksum mismatch, expected %08X" % checksum)
+        sys.exit(2)
@@ -1,7 +1,7 @@
 #include "cartridges/Cartridge.h"
 
 cartridges::Cartridge::Cartridge(IChecksumCalculator& checksumCalculator)
-    : mChecksumCalculator(checksumCalculator) {
+    : mChecksumCalculator(checksumCalculator), mFlash(*this) {
     setDefaults();
 }
 
@@ -26,3 +26,98 @@ void cartridges::Cartridge::TestWait(void){
 void cartridges::Cartridge::ResetChecksumCalculator(){
     mChecksumCalculator.Reset();
 }
+
+// MARK: ReadMemoryVerified()
+uint8_t cartridges::Cartridge::ReadMemoryVerified(uint32_t address, cartridges::Array& array, uint8_t memTypeIndex, ReadOptions opt){
+    uint8_t retries = 0;
+    // the vote doesn't care about the byte order, raw reads save a swap per read
+    ReadOptions order = opt == BUS_ORDER ? BUS_ORDER : NONE;
+
+    ReadMemory(address, array, memTypeIndex, order);
+    uint32_t size = array.AvailableSize();
+    uint32_t words = (size + 3) / 4;
+
+    mVerifyArray.SetTransferSize(size);
+    ReadMemory(address, mVerifyArray, memTypeIndex, order);
+
+    // array holds the vote so far, mVerifyArray the latest read
+    while(std::memcmp(array.Data(), mVerifyArray.Data(), size) != 0){
+        if(retries == MAX_VERIFY_RETRIES){
+            mVerifyStats.UnsettledBlocks++;
+            break;
+        }
+
+        mVoteArray.SetTransferSize(size);
+        ReadMemory(address, mVoteArray, memTypeIndex, order);
+        retries++;
+
+        for(uint32_t i = 0; i < words; i++){
+            uint32_t a = array.Long(i << 2);
+            uint32_t b = mVerifyArray.Long(i << 2);
+            uint32_t c = mVoteArray.Long(i << 2);
+            array.Long(i << 2) = (a & b) | (a & c) | (b & c);
+        }
+        std::memcpy(mVerifyArray.Data(), mVoteArray.Data(), size);
+    }
+
+    mVerifyStats.Blocks++;
+    if(retries != 0){
+        if(mVerifyStats.RetriedBlocks == 0){
+            mVerifyStats.FirstRetriedAddress = address;
+        }
+        mVerifyStats.RetriedBlocks++;
+        mVerifyStats.Retries += retries;
+    }
+
+    if(opt == CHECKSUM_CALCULATOR){
+        mChecksumCalculator.Accumulate(&array.Long(0), size / 4);
+    }
+    return retries;
+}
+
+// MARK: IdentifyFlash()
+cartridges::FlashInfo cartridges::Cartridge::IdentifyFlash(uint16_t manufacturer, uint16_t device, uint32_t maxSize){
+    FlashInfo info(manufacturer, device);
+
+    if(!info.HasGeometry()){
+        FlashChip chip;
+        if(mFlash.QueryCfi(chip, maxSize)){
+            info = FlashInfo(manufacturer, device, chip);
+        }
+    }
+
+    if(info.HasGeometry()){
+        info.SetChipCount(CountFlashChips(manufacturer, device, info.Size, maxSize));
+    }
+
+    mFlash.Configure(info);
+    return info;
+}
+
+// MARK: CountFlashChips()
+uint8_t cartridges::Cartridge::CountFlashChips(uint16_t manufacturer, uint16_t device, uint32_t chipSize, uint32_t maxSize){
+    uint8_t count = 1;
+
+    // the first chip in autoselect mode would read back its ID, this tells a mirror apart from a second chip
+    uint16_t first = FlashRead(0);
+    uint16_t second = FlashRead(1);
+
+    while(count < FlashInterleaver::MAX_CHIPS && (uint64_t)(count + 1) * chipSize <= maxSize){
+        uint32_t base = (count * chipSize) >> 1;
+
+        FlashWrite(base + 0x555, 0x00AA);
+        FlashWrite(base + 0x2AA, 0x0055);
+        FlashWrite(base + 0x555, 0x0090);
+        bool sameId = FlashRead(base) == manufacturer && FlashRead(base + 1) == device;
+        bool mirrored = FlashRead(0) != first || FlashRead(1) != second;
+        FlashWrite(base, 0x00F0);
+        FlashWrite(0, 0x00F0);
+
+        if(!sameId || mirrored){
+            break;
+        }
+        count++;
+    }
+
+    return count;
+}
@@ -8,16 +8,20 @@ cartridges::genesis::Cart::Cart(IChecksumCalculator& checksumCalculator)
 
     // display will show these memory names in order
     // so here we store an index to the memory enum
-    // mMemoryTypeIndexMap[0] = MemoryType::PRG0;
-    // mMemoryNames.push_back("ROM");
+    mMemoryTypeIndexMap[0] = MemoryType::PRG0;
+    mMemoryNames.push_back("ROM");
 
-    // mMemoryTypeIndexMap[1] = MemoryType::RAM0;
-    // mMemoryNames.push_back("Save RAM");
+    mMemoryTypeIndexMap[1] = MemoryType::RAM0;
+    mMemoryNames.push_back("Save RAM");
 
-    // mMemoryTypeIndexMap[2] = MemoryType::BRAM;
-    // mMemoryNames.push_back("SCD Backup RAM");
+    mMemoryTypeIndexMap[2] = MemoryType::BRAM;
+    mMemoryNames.push_back("SCD Backup RAM");
 
     mMetadata.clear();
+
+    // the system type in the header of boards with the SSF bank switching mapper, and of 32X games
+    mSignatures.push_back("SEGA SSF");
+    mSignatures.push_back("SEGA 32X");
 }
 
 // MARK: Destructor
@@ -81,6 +85,9 @@ uint32_t cartridges::genesis::Cart::GetMemorySize(uint8_t memTypeIndex){
         case MemoryType::PRG0:
             ReadHeader();
             return mHeader.ROMEnd + 1;
+        case MemoryType::RAM0:
+            ReadHeader();
+            return mSramSize;
         default:
             return 0;
     }
@@ -115,8 +122,7 @@ cartridges::FlashInfo cartridges::genesis::Cart::GetFlashInfo(uint8_t memTypeInd
             return FlashInfo(0, 0);
     }
     
-    FlashInfo info(manufacturer, device);
-    return info;
+    return IdentifyFlash(manufacturer, device, PRG_ADDRESS_SPACE);
 }
 
 // MARK: Identify()
@@ -124,10 +130,14 @@ uint32_t cartridges::genesis::Cart::Identify(uint32_t address, cartridges::Array
 
     array.Next();
 
+    // capture in bus order, the bytes are put in file order in one pass
     for(int i = 0; i < array.AvailableSize(); i+=2){
-        array.Word(i) = ReadPrgWord(address);
+        array.Word(i) = ReadPrgBusWord(address);
         address += 2;
     }
+    if(opt != BUS_ORDER){
+        array.SwapWordBytes();
+    }
 
     switch(opt){
         case CHECKSUM_CALCULATOR:
@@ -152,9 +162,25 @@ uint32_t cartridges::genesis::Cart::ReadMemory(uint32_t address, cartridges::Arr
     switch(mem){
         case MemoryType::PRG0:
             for(int i = 0; i < array.AvailableSize(); i+=2){
-                array.Word(i) = ReadPrgWord(address);
+                array.Word(i) = ReadPrgBusWord(address);
                 address += 2;
             }
+            if(opt != BUS_ORDER){
+                array.SwapWordBytes();
+            }
+            break;
+        case MemoryType::RAM0:
+            if(mSramStride == 0){
+                ReadHeader();
+            }
+            if(mSramStride == 0){
+                break;
+            }
+            enableSram(true);
+            for(int i = 0; i < array.AvailableSize(); i++){
+                array[i] = ReadSramByte(SramAddress(address + i));
+            }
+            enableSram(false);
             break;
         default:
             break;
@@ -167,6 +193,12 @@ uint32_t cartridges::genesis::Cart::ReadMemory(uint32_t address, cartridges::Arr
     }
 }
 
+// MARK: IsBusOrderSwapped()
+bool cartridges::genesis::Cart::IsBusOrderSwapped(uint8_t memTypeIndex) const{
+    // the SRAM is read a byte at a time
+    return IsMemoryIndexValid(memTypeIndex) && GetMemoryType(memTypeIndex) == MemoryType::PRG0;
+}
+
 // MARK: EraseFlash()
 int cartridges::genesis::Cart::EraseFlash(uint8_t memTypeIndex){
     // check if the memTypeIndex is valid
@@ -178,12 +210,31 @@ int cartridges::genesis::Cart::EraseFlash(uint8_t memTypeIndex){
     
     switch(mem){
         case MemoryType::PRG0:
-            WritePrgWord(0x00000555 < 1, 0xAA00);
-            WritePrgWord(0x000002AA < 1, 0x5500);
-            WritePrgWord(0x00000555 < 1, 0x8000);
-            WritePrgWord(0x00000555 < 1, 0xAA00);
-            WritePrgWord(0x000002AA < 1, 0x5500);
-            WritePrgWord(0x00000555 < 1, 0x1000);
+            mFlash.BeginChipErase();
+            break;
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+// MARK: EraseFlashSector()
+int cartridges::genesis::Cart::EraseFlashSector(uint32_t address, uint8_t memTypeIndex){
+    // check if the memTypeIndex is valid
+    if(!IsMemoryIndexValid(memTypeIndex)){
+        return -1;
+    }
+
+    MemoryType mem = mMemoryTypeIndexMap[memTypeIndex];
+
+    switch(mem){
+        case MemoryType::PRG0:
+            if(!mFlash.IsConfigured()){
+                GetFlashInfo(memTypeIndex);
+            }
+            if(mFlash.BeginSectorErase(address >> 1) != FlashProgrammer::Status::BUSY){
+                return -1;
+            }
             break;
         default:
             return -1;
@@ -191,15 +242,91 @@ int cartridges::genesis::Cart::EraseFlash(uint8_t memTypeIndex){
     return 0;
 }
 
-int cartridges::genesis::Cart::ProgramFlash(uint32_t address, uint8_t *buffer, uint16_t size, uint8_t mem){
+// MARK: EraseFlashRange()
+int cartridges::genesis::Cart::EraseFlashRange(uint32_t address, uint32_t size, uint8_t memTypeIndex){
+    // check if the memTypeIndex is valid
+    if(!IsMemoryIndexValid(memTypeIndex)){
+        return -1;
+    }
+
+    MemoryType mem = mMemoryTypeIndexMap[memTypeIndex];
+
+    switch(mem){
+        case MemoryType::PRG0:
+            if(!mFlash.IsConfigured()){
+                GetFlashInfo(memTypeIndex);
+            }
+            switch(mFlash.BeginEraseRange(address >> 1, size >> 1)){
+                case FlashProgrammer::Status::BUSY:
+                case FlashProgrammer::Status::IDLE:
+                    break;
+                default:
+                    return -1;
+            }
+            break;
+        default:
+            return -1;
+    }
     return 0;
 }
 
-bool cartridges::genesis::Cart::IsFlashBusy(uint8_t mem){
-    if((TogglePrgBit(4) != 4)) 
+// MARK: ProgramFlash()
+int cartridges::genesis::Cart::ProgramFlash(uint32_t address, uint8_t *buffer, uint16_t size, uint8_t memTypeIndex){
+    // check if the memTypeIndex is valid
+    if(!IsMemoryIndexValid(memTypeIndex)){
+        return -1;
+    }
+
+    // SRAM is written directly, there is nothing to wait for
+    if(mMemoryTypeIndexMap[memTypeIndex] == MemoryType::RAM0){
+        return WriteSram(address, buffer, size) ? 0 : -1;
+    }
+
+    if(BeginProgramFlash(address, buffer, size, memTypeIndex) != 0){
+        return -1;
+    }
+
+    while(IsFlashBusy(memTypeIndex));
+
+    return GetFlashStatus() == FlashProgrammer::Status::IDLE ? 0 : -1;
+}
+
+// MARK: BeginProgramFlash()
+int cartridges::genesis::Cart::BeginProgramFlash(uint32_t address, const uint8_t *buffer, uint16_t size, uint8_t memTypeIndex){
+    // check if the memTypeIndex is valid
+    if(!IsMemoryIndexValid(memTypeIndex)){
+        return -1;
+    }
+
+    MemoryType mem = mMemoryTypeIndexMap[memTypeIndex];
+
+    switch(mem){
+        case MemoryType::PRG0:
+            // the chip id selects the programming algorithm
+            if(!mFlash.IsConfigured()){
+                GetFlashInfo(memTypeIndex);
+            }
+            if(mFlash.BeginProgram(address >> 1, buffer, size >> 1) == FlashProgrammer::Status::BUSY){
+                return 0;
+            }
+            // nothing to program at all is still a success
+            return mFlash.GetStatus() == FlashProgrammer::Status::IDLE ? 0 : -1;
+        case MemoryType::RAM0:
+            return WriteSram(address, buffer, size) ? 0 : -1;
+        default:
+            return -1;
+    }
+}
+
+bool cartridges::genesis::Cart::IsFlashBusy(uint8_t memTypeIndex){
+    // only the flash has operations in progress, don't touch the bus for the other memories
+    if(IsMemoryIndexValid(memTypeIndex) && mMemoryTypeIndexMap[memTypeIndex] != MemoryType::PRG0){
         return false;
-    
-    return true;
+    }
+    if(mFlash.GetStatus() == FlashProgrammer::Status::BUSY){
+        return mFlash.Service() == FlashProgrammer::Status::BUSY;
+    }
+    return mFlash.IsToggling();
 }
 
 // MARK: ReadHeader
@@ -218,6 +345,22 @@ void cartridges::genesis::Cart::ReadHeader(){
     mHeader.SRAMEnd = UMD_SWAP_BYTES_32(mHeader.SRAMEnd);
     mHeader.Checksum = UMD_SWAP_BYTES_16(mHeader.Checksum);
 
+    // battery backed SRAM is declared with "RA", byte wide SRAM only sits on the odd or the even addresses
+    mSramStart = 0;
+    mSramSize = 0;
+    mSramStride = 0;
+    if(mHeader.MemoryType[0] == 'R' && mHeader.MemoryType[1] == 'A' && mHeader.SRAMEnd >= mHeader.SRAMStart){
+        uint8_t lanes = (mHeader.RAMType >> 3) & 0x03;
+        if(lanes == SRAM_LANES_BOTH){
+            mSramStart = mHeader.SRAMStart;
+            mSramStride = 1;
+        }else{
+            mSramStart = (mHeader.SRAMStart & 0xFFFFFFFE) | (lanes == SRAM_LANES_ODD ? 1 : 0);
+            mSramStride = 2;
+        }
+        mSramSize = mHeader.SRAMEnd >= mSramStart ? (mHeader.SRAMEnd - mSramStart) / mSramStride + 1 : 0;
+    }
+
     // ExpectedChecksum = mHeader.Checksum;
 
     // check if the first 4 character of mHeader.SystemType are "SEGA"
@@ -246,28 +389,6 @@ void cartridges::genesis::Cart::ReadHeader(){
     mMetadata.push_back(mHeader.Printable.SerialNumber);
 }
 
-uint8_t cartridges::genesis::Cart::TogglePrgBit(uint8_t attempts){
-    uint8_t retValue = 0;
-    uint8_t readValue;
-    uint8_t oldValue;
-    uint8_t i;
-
-    //first read should always be a 1 according to datasheet
-    oldValue = ReadPrgWord(0x00000000);
-
-    for(int i = 0; i < attempts; i++){
-        readValue = ReadPrgWord(0x00000000) & 0x4000;
-        if(oldValue == readValue){
-			retValue += 1;
-		}else{
-			retValue = 0;
-		}
-		oldValue = readValue;
-	}
-    
-    return retValue;
-}
-
 bool cartridges::genesis::Cart::calculateChecksum(uint32_t start, uint32_t end){
     uint16_t checksum = 0;
     for(uint32_t i = start; i < end; i+=2){
@@ -421,6 +542,62 @@ void cartridges::genesis::Cart::enableSram(bool enable){
     dataSetToInputs(true);
 }
 
+// MARK: SRAM
+uint8_t cartridges::genesis::Cart::ReadSramByte(uint32_t address){
+    // the word comes back in file order, the even byte first
+    uint16_t word = ReadPrgWord(address & 0xFFFFFFFE);
+    return (address & 1) ? (uint8_t)(word >> 8) : (uint8_t)word;
+}
+
+void cartridges::genesis::Cart::WriteSramByte(uint32_t address, uint8_t data){
+    addressWrite(address);
+    dataSetToOutputs();
+
+    // odd bytes are strobed with LWR on the low byte lane, even bytes with WR on the high one
+    clearCE();
+    clearAS();
+    if(address & 1){
+        dataWriteLow(data);
+        clearLWR();
+        wait200ns();
+        setLWR();
+    }else{
+        dataWriteHigh(data);
+        clearWR();
+        wait200ns();
+        setWR();
+    }
+    setAS();
+    setCE();
+
+    // always leave on inputs by default
+    dataSetToInputs(true);
+}
+
+/// @brief Write a block of the save file to SRAM, every byte is read back once to check it stuck. Bytes already
+/// holding the right value are still written, callers wanting fewer writes compare first.
+bool cartridges::genesis::Cart::WriteSram(uint32_t offset, const uint8_t *buffer, uint16_t size){
+    if(mSramStride == 0){
+        ReadHeader();
+    }
+    if(mSramStride == 0 || offset > mSramSize || size > mSramSize - offset){
+        return false;
+    }
+
+    bool result = true;
+    enableSram(true);
+    for(uint16_t i = 0; i < size; i++){
+        uint32_t address = SramAddress(offset + i);
+        WriteSramByte(address, buffer[i]);
+        if(ReadSramByte(address) != buffer[i]){
+            result = false;
+            break;
+        }
+    }
+    enableSram(false);
+    return result;
+}
+
 uint8_t cartridges::genesis::Cart::readPrgByte(uint32_t address){
 
     uint8_t result;
@@ -451,13 +628,19 @@ void cartridges::genesis::Cart::writePrgByte(uint32_t address, uint8_t data){
 }
 
 uint16_t cartridges::genesis::Cart::ReadPrgWord(uint32_t address){
+    // the macro evaluates its argument twice
+    uint16_t word = ReadPrgBusWord(address);
+    return UMD_SWAP_BYTES_16(word);
+}
+
+uint16_t cartridges::genesis::Cart::ReadPrgBusWord(uint32_t address){
     uint16_t result;
     addressWrite(address);
     clearCE();
     clearAS();
     clearRD();
     wait200ns();
-    result = dataReadWordSwapped();
+    result = dataReadWord();
     setRD();
     setAS();
     setCE();
@@ -480,3 +663,12 @@ void cartridges::genesis::Cart::WritePrgWord(uint32_t address, uint16_t data){
     dataSetToInputs(true);
 }
 
+// MARK: IFlashBus
+void cartridges::genesis::Cart::FlashWrite(uint32_t wordAddress, uint16_t data){
+    WritePrgWord(wordAddress << 1, UMD_SWAP_BYTES_16(data));
+}
+
+uint16_t cartridges::genesis::Cart::FlashRead(uint32_t wordAddress){
+    uint16_t data = ReadPrgWord(wordAddress << 1);
+    return UMD_SWAP_BYTES_16(data);
+}
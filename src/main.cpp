@@ -25,8 +25,6 @@ using umd::Cart::CartState;
 #define SD_DETECT_PIN PD0
 #endif
 
-#define SD_CLK_DIV  8
-
 //SdFatFs fatFs;
 File sdFile;
 SerialCommand SCmd;
@@ -80,9 +78,6 @@ void setup()
         while (1);
     }
 
-    // reduce the SDIO clock, seems more stable like this
-    SDIO->CLKCR |= SD_CLK_DIV; 
-
     // check that the SD cart is properly formatted for UMDv3
     int sdVerify = verifySdCard();
     if(sdVerify != 0)
@@ -92,6 +87,11 @@ void setup()
         while (1);
     }
 
+    // pick the fastest reliable SDIO clock for this card, measured on the first boot with it
+    umd::SdTuner::Setting sdSetting = umd::SdTune.Tune("/UMD/.sdtune.tmp", "/UMD/sdtune.txt");
+    umd::Ux::Display.Printf(UMDDisplay::ZONE_WINDOW, F("-sd %lukHz %s"), umd::SdTuner::ClockKHz(sdSetting), sdSetting.WideBus ? "4bit" : "1bit");
+    umd::Ux::Display.Redraw();
+
     // setup onboard mcp23008, GP6 and GP7 LED outputs
     umd::Ux::Display.Printf(UMDDisplay::ZONE_WINDOW, F("-mcp23008 io expander"));
     umd::Ux::Display.Redraw();
@@ -192,6 +192,12 @@ void loop()
     previousTicks = currentTicks;
     currentTicks = HAL_GetTick();
 
+    // slow the SD card down if the last operation hit transfer errors
+    if(umd::SdTune.CheckErrors())
+    {
+        umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("sd slowed to %lukHz"), umd::SdTuner::ClockKHz(umd::SdTune.GetSetting()));
+    }
+
     // process inputs
     uint8_t inputs = umd::IoExpander.readGPIO();
     umd::Ux::Keys.Process(inputs, currentTicks);
@@ -265,6 +271,14 @@ void loop()
                                 umd::Ux::Display.NewWindow(umd::Cart::Metadata);
                                 umd::Ux::Display.Printf(F("Size : %08X"), totalBytes);
                                 umd::Ux::Display.Printf(F("CRC  : %08X"), umd::Cart::pCartridge->GetAccumulatedChecksum());
+                                // signatures found while the ROM was checksummed
+                                for(uint8_t i = 0; i < umd::Scanner.GetPatternCount(); i++)
+                                {
+                                    if(umd::Scanner.GetHit(i).Count != 0)
+                                    {
+                                        umd::Ux::Display.Printf(F("Sig  : %s @%06lX"), umd::Scanner.GetPattern(i), umd::Scanner.GetHit(i).FirstAddress);
+                                    }
+                                }
                                                                 
                                 // search for this game id in the database
                                 // umd::StringStream.clear();
@@ -290,6 +304,33 @@ void loop()
                                 umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
                                 umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
                                 break;
+                            // MARK: Select Safe Read
+                            case CartState::SAFE_READ:
+                                // update state to SAFE_READ, every block is read twice and re-read until it settles
+                                umd::Cart::State = CartState::SAFE_READ;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "Safe");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            // MARK: Select Packed Read
+                            case CartState::PACKED_READ:
+                                // update state to PACKED_READ, the dump is compressed on the way to the SD card
+                                umd::Cart::State = CartState::PACKED_READ;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "Packed");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            // MARK: Select USB Read
+                            case CartState::USB_READ:
+                                // update state to USB_READ, the dump goes to the SD card and to the host at once
+                                umd::Cart::State = CartState::USB_READ;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "USB");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
                             // MARK: Select Write
                             case CartState::WRITE:
                                 // update state to WRITE and offer choice of memory to write to
@@ -299,6 +340,60 @@ void loop()
                                 umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
                                 umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
                                 break;
+                            // MARK: Select Flash
+                            case CartState::FLASH:
+                                // update state to FLASH, only the sectors that differ from the file are written
+                                umd::Cart::State = CartState::FLASH;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "Flash");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            // MARK: Select Patch
+                            case CartState::PATCH:
+                                // update state to PATCH, a base ROM is written with a patch applied on the fly
+                                umd::Cart::State = CartState::PATCH;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "Patch");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            // MARK: Select Restore
+                            case CartState::RESTORE:
+                                // update state to RESTORE, a save file is written back to the save RAM
+                                umd::Cart::State = CartState::RESTORE;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "Restore");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            // MARK: Select Sync
+                            case CartState::SYNC:
+                                // update state to SYNC, only the bytes of the save RAM that differ from the file are written
+                                umd::Cart::State = CartState::SYNC;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "Sync");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            // MARK: Select Compare
+                            case CartState::COMPARE:
+                                // update state to COMPARE, a memory is compared with a file without writing anything
+                                umd::Cart::State = CartState::COMPARE;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "Compare");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            // MARK: Select Check
+                            case CartState::CHECK:
+                                // update state to CHECK, a memory is checked against the block map of a dump or of the db
+                                umd::Cart::State = CartState::CHECK;
+                                umd::Ux::Display.Printf(UMDDisplay::ZONE_TITLE, F("UMDv3/%s/%s"), umd::Cart::pCartridge->GetSystemName().c_str(), "Check");
+                                umd::Ux::Display.NewWindow(umd::Cart::MemoryNames);
+                                umd::Ux::State = umd::Ux::UX_SELECT_MEMORY;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
                             default:
                                 umd::Cart::State = CartState::IDLE;
                                 umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
@@ -311,14 +406,62 @@ void loop()
                         switch(umd::Cart::State)
                         {
                             case CartState::READ:
+                            case CartState::SAFE_READ:
+                            case CartState::PACKED_READ:
+                            case CartState::USB_READ:
                                 // check if the cartridge has been identified
                                 if(!umd::Cart::IsIdentified)
                                 {
                                     umd::Cart::Identify(true);
                                 }
 
-                                // selected index indicates the memory to read from
-                                umd::Cart::DumpToFile(selectedItemIndex, umd::Cart::Name + ".bin", true);
+                                // selected index indicates the memory to read from, saves and packed dumps get their own extension
+                                if(umd::Cart::DumpToFile(selectedItemIndex,
+                                    umd::Cart::Name + (umd::Cart::State == CartState::PACKED_READ ? ".umz" : (umd::Cart::pCartridge->IsSaveMemory(selectedItemIndex) ? ".sav" : ".bin")),
+                                    umd::Cart::State == CartState::SAFE_READ, umd::Cart::State == CartState::PACKED_READ,
+                                    umd::Cart::State == CartState::USB_READ, true))
+                                {
+                                    if(umd::Cart::DumpSkipped)
+                                    {
+                                        umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("on card, crc %08lX"), umd::Cart::DumpChecksum);
+                                    }
+                                    else
+                                    {
+                                        umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, umd::Cart::DumpResumed ? F("resumed crc %08lX") : F("crc %08lX"), umd::Cart::DumpChecksum);
+                                        // the stage the dump was bound by
+                                        umd::Ux::Display.Printf(F("Slow : %s %lukB/s"), umd::Stream.GetSlowestStage()->GetName(), umd::Stream.GetSlowestStage()->GetStats().BytesPerSecond() / 1024);
+                                    }
+                                    if(!umd::Cart::DumpSkipped && !umd::Cart::pCartridge->IsSaveMemory(selectedItemIndex) && umd::Scanner.GetFoundCount() != 0)
+                                    {
+                                        umd::Ux::Display.Printf(F("Sigs : %u found"), umd::Scanner.GetFoundCount());
+                                    }
+                                    if(umd::Cart::State == CartState::USB_READ)
+                                    {
+                                        // the SD card or the host, whichever held the other back
+                                        umd::Ux::Display.Printf(F("Tee  : %s %lukB/s"), umd::FileAndUsb.GetSlowerBranch().GetName(), umd::FileAndUsb.GetSlowerBranch().GetStats().BytesPerSecond() / 1024);
+                                    }
+                                    if(umd::Cart::State == CartState::PACKED_READ)
+                                    {
+                                        umd::Ux::Display.Printf(F("Packed: %lu/%lu"), umd::Packer.GetPackedSize(), umd::Cart::pCartridge->GetMemorySize(selectedItemIndex));
+                                    }
+                                    if(umd::Cart::State == CartState::SAFE_READ)
+                                    {
+                                        const cartridges::Cartridge::VerifyStats& stats = umd::Cart::pCartridge->GetVerifyStats();
+                                        umd::Ux::Display.Printf(F("Retried: %lu/%lu blocks"), stats.RetriedBlocks, stats.Blocks);
+                                        if(stats.RetriedBlocks != 0)
+                                        {
+                                            umd::Ux::Display.Printf(F("First: %08lX"), stats.FirstRetriedAddress);
+                                            umd::Ux::Display.Printf(F("Unsettled: %lu"), stats.UnsettledBlocks);
+                                            // every retried block is listed next to the dump
+                                            umd::Ux::Display.Printf(F("List : .rty"));
+                                        }
+                                    }
+                                }
+                                else
+                                {
+                                    // the journal is kept, reading the same memory again continues the dump
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, umd::Cart::State == CartState::PACKED_READ ? F("err: dump failed") : F("err: dump stopped"));
+                                }
 
                                 // all done, return to main menu
                                 umd::Cart::State = CartState::IDLE;
@@ -326,13 +469,222 @@ void loop()
                                 umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_PRESSED;
                                 break;
                             case CartState::WRITE:
-                                // selected index indicates the memory to write to
-                                
-                                // all done, return to main menu
+                            case CartState::FLASH:
+                            case CartState::PATCH:
+                                // selected index indicates the memory to write to, offer a choice of file
+                                umd::Cart::SelectedMemoryIndex = selectedItemIndex;
+                                if(umd::Cart::ListFiles({".bin"}) == 0)
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: no .bin files"));
+                                    umd::Cart::State = CartState::IDLE;
+                                    umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                    umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                    break;
+                                }
+                                umd::Ux::Display.NewWindow(umd::Cart::FileNamesMenu);
+                                umd::Ux::State = umd::Ux::UX_SELECT_FILE;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            case CartState::RESTORE:
+                            case CartState::SYNC:
+                                // selected index indicates the save memory to write to, offer a choice of save file
+                                umd::Cart::SelectedMemoryIndex = selectedItemIndex;
+                                if(!umd::Cart::pCartridge->IsSaveMemory(selectedItemIndex))
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: not a save memory"));
+                                    umd::Cart::State = CartState::IDLE;
+                                    umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                    umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                    break;
+                                }
+                                if(umd::Cart::ListFiles({".sav"}) == 0)
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: no .sav files"));
+                                    umd::Cart::State = CartState::IDLE;
+                                    umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                    umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                    break;
+                                }
+                                umd::Ux::Display.NewWindow(umd::Cart::FileNamesMenu);
+                                umd::Ux::State = umd::Ux::UX_SELECT_FILE;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            case CartState::COMPARE:
+                                // selected index indicates the memory to compare, offer a choice of dump
+                                umd::Cart::SelectedMemoryIndex = selectedItemIndex;
+                                if(umd::Cart::ListFiles({".bin", ".sav"}) == 0)
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: no dump files"));
+                                    umd::Cart::State = CartState::IDLE;
+                                    umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                    umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                    break;
+                                }
+                                umd::Ux::Display.NewWindow(umd::Cart::FileNamesMenu);
+                                umd::Ux::State = umd::Ux::UX_SELECT_FILE;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            case CartState::CHECK:
+                                // selected index indicates the memory to check, offer a choice of block map
+                                umd::Cart::SelectedMemoryIndex = selectedItemIndex;
+                                if(umd::Cart::ListFiles({".crc"}) == 0)
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: no .crc files"));
+                                    umd::Cart::State = CartState::IDLE;
+                                    umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                    umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                    break;
+                                }
+                                // the known good map of an identified game comes first
+                                umd::Cart::OfferGameBlockMap(selectedItemIndex);
+                                umd::Ux::Display.NewWindow(umd::Cart::FileNamesMenu);
+                                umd::Ux::State = umd::Ux::UX_SELECT_FILE;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            default:
                                 umd::Cart::State = CartState::IDLE;
                                 umd::Ux::State = umd::Ux::UX_MAIN_MENU;
                                 umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_PRESSED;
                                 break;
+                        }
+                        break;
+                    // MARK: Select File
+                    case umd::Ux::UX_SELECT_FILE:
+
+                        switch(umd::Cart::State)
+                        {
+                            case CartState::WRITE:
+                                umd::Ux::Display.ClearZone(UMDDisplay::ZONE_STATUS);
+                                umd::Ux::Display.NewWindow({umd::Cart::FileNamesMenu[selectedItemIndex]});
+                                if(umd::Cart::WriteFromFile(umd::Cart::SelectedMemoryIndex, umd::Cart::FileNames[selectedItemIndex], true))
+                                {
+                                    umd::Ux::Display.Printf(F("Rate : %lu w/s"), umd::Cart::pCartridge->GetFlashStats().WordsPerSecond());
+                                    umd::Ux::Display.Printf(F("CRC  : %08X"), umd::Cart::WrittenChecksum);
+                                }
+                                else if(umd::Cart::VerifyBadBlocks != 0)
+                                {
+                                    umd::Ux::Display.Printf(F("Bad  : %lu blocks"), umd::Cart::VerifyBadBlocks);
+                                    umd::Ux::Display.Printf(F("First: %08X"), umd::Cart::VerifyFirstBadAddress);
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: verify failed"));
+                                }
+                                else if(umd::Cart::SourceMismatch)
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: SD read mismatch"));
+                                }
+                                else
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: write failed"));
+                                }
+
+                                // all done, return to main menu
+                                umd::Cart::State = CartState::IDLE;
+                                umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            case CartState::FLASH:
+                                umd::Ux::Display.ClearZone(UMDDisplay::ZONE_STATUS);
+                                umd::Ux::Display.NewWindow({umd::Cart::FileNamesMenu[selectedItemIndex]});
+                                if(umd::Cart::DeltaWriteFromFile(umd::Cart::SelectedMemoryIndex, umd::Cart::FileNames[selectedItemIndex], true))
+                                {
+                                    umd::Ux::Display.Printf(F("Delta: %lu/%lu sectors"), umd::Cart::DeltaSectorsChanged, umd::Cart::DeltaSectorsTotal);
+                                }
+                                else if(umd::Cart::VerifyBadBlocks != 0)
+                                {
+                                    umd::Ux::Display.Printf(F("Bad  : %08X"), umd::Cart::VerifyFirstBadAddress);
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: verify failed"));
+                                }
+                                else
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: flash failed"));
+                                }
+
+                                // all done, return to main menu
+                                umd::Cart::State = CartState::IDLE;
+                                umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            case CartState::RESTORE:
+                            case CartState::SYNC:
+                                umd::Ux::Display.ClearZone(UMDDisplay::ZONE_STATUS);
+                                umd::Ux::Display.NewWindow({umd::Cart::FileNamesMenu[selectedItemIndex]});
+                                if(umd::Cart::RestoreSaveFromFile(umd::Cart::SelectedMemoryIndex, umd::Cart::FileNames[selectedItemIndex], umd::Cart::State == CartState::SYNC, true))
+                                {
+                                    umd::Ux::Display.Printf(F("Wrote: %lu bytes"), umd::Cart::SaveBytesWritten);
+                                }
+                                else
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: restore failed"));
+                                }
+
+                                // all done, return to main menu
+                                umd::Cart::State = CartState::IDLE;
+                                umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            case CartState::COMPARE:
+                                umd::Ux::Display.ClearZone(UMDDisplay::ZONE_STATUS);
+                                umd::Ux::Display.NewWindow({umd::Cart::FileNamesMenu[selectedItemIndex]});
+                                if(umd::Cart::CompareToFile(umd::Cart::SelectedMemoryIndex, umd::Cart::FileNames[selectedItemIndex], true))
+                                {
+                                    umd::Ux::Display.Printf(F("CRC  : %08lX"), umd::Cart::CompareChecksum);
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("match"));
+                                }
+                                else if(umd::Cart::CompareMismatch)
+                                {
+                                    umd::Ux::Display.Printf(F("Addr : %08X"), umd::Cart::CompareAddress);
+                                    umd::Ux::Display.Printf(F("Cart : %04X"), umd::Cart::CompareCartWord);
+                                    umd::Ux::Display.Printf(F("File : %04X"), umd::Cart::CompareFileWord);
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: mismatch"));
+                                }
+                                else
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: compare failed"));
+                                }
+
+                                // all done, return to main menu
+                                umd::Cart::State = CartState::IDLE;
+                                umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            case CartState::CHECK:
+                                umd::Ux::Display.ClearZone(UMDDisplay::ZONE_STATUS);
+                                umd::Ux::Display.NewWindow({umd::Cart::FileNamesMenu[selectedItemIndex]});
+                                if(umd::Cart::CheckBlockMap(umd::Cart::SelectedMemoryIndex, umd::Cart::FileNames[selectedItemIndex], false, true))
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("all blocks match"));
+                                }
+                                else if(umd::Cart::VerifyBadBlocks != 0)
+                                {
+                                    // the range of the blocks that differ narrows down a bad dump
+                                    umd::Ux::Display.Printf(F("Bad  : %lu blocks"), umd::Cart::VerifyBadBlocks);
+                                    umd::Ux::Display.Printf(F("%06lX-%06lX"), umd::Cart::VerifyFirstBadAddress, umd::Cart::VerifyLastBadAddress);
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: blocks differ"));
+                                }
+                                else
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: bad block map"));
+                                }
+
+                                // all done, return to main menu
+                                umd::Cart::State = CartState::IDLE;
+                                umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
+                            case CartState::PATCH:
+                                // selected file is the base ROM, offer a choice of patch
+                                umd::Cart::SelectedFileName = umd::Cart::FileNames[selectedItemIndex];
+                                if(umd::Cart::ListFiles({".ips", ".bps"}) == 0)
+                                {
+                                    umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: no patch files"));
+                                    umd::Cart::State = CartState::IDLE;
+                                    umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                                    umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                    break;
+                                }
+                                umd::Ux::Display.NewWindow(umd::Cart::FileNamesMenu);
+                                umd::Ux::State = umd::Ux::UX_SELECT_PATCH;
+                                umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                                break;
                             default:
                                 umd::Cart::State = CartState::IDLE;
                                 umd::Ux::State = umd::Ux::UX_MAIN_MENU;
@@ -340,6 +692,45 @@ void loop()
                                 break;
                         }
                         break;
+                    // MARK: Select Patch File
+                    case umd::Ux::UX_SELECT_PATCH:
+                        umd::Ux::Display.ClearZone(UMDDisplay::ZONE_STATUS);
+                        umd::Ux::Display.NewWindow({umd::Cart::SelectedFileName.c_str(), umd::Cart::FileNamesMenu[selectedItemIndex]});
+                        if(umd::Cart::PatchWriteFromFile(umd::Cart::SelectedMemoryIndex, umd::Cart::SelectedFileName, umd::Cart::FileNames[selectedItemIndex], true))
+                        {
+                            umd::Ux::Display.Printf(F("Rate : %lu w/s"), umd::Cart::pCartridge->GetFlashStats().WordsPerSecond());
+                            umd::Ux::Display.Printf(F("CRC  : %08X"), umd::Cart::WrittenChecksum);
+                        }
+                        else if(umd::Cart::PatchError == patch::IPatchStream::Error::BAD_SOURCE_SIZE ||
+                                umd::Cart::PatchError == patch::IPatchStream::Error::BAD_SOURCE_CRC)
+                        {
+                            umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: wrong base rom"));
+                        }
+                        else if(umd::Cart::PatchError == patch::IPatchStream::Error::BAD_TARGET_CRC)
+                        {
+                            umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: patch crc"));
+                        }
+                        else if(umd::Cart::PatchError != patch::IPatchStream::Error::NONE)
+                        {
+                            umd::Ux::Display.Printf(F("Error: %u"), (unsigned int)umd::Cart::PatchError);
+                            umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: bad patch"));
+                        }
+                        else if(umd::Cart::VerifyBadBlocks != 0)
+                        {
+                            umd::Ux::Display.Printf(F("Bad  : %lu blocks"), umd::Cart::VerifyBadBlocks);
+                            umd::Ux::Display.Printf(F("First: %08X"), umd::Cart::VerifyFirstBadAddress);
+                            umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: verify failed"));
+                        }
+                        else
+                        {
+                            umd::Ux::Display.Printf(UMDDisplay::ZONE_STATUS, F("err: write failed"));
+                        }
+
+                        // all done, return to main menu
+                        umd::Cart::State = CartState::IDLE;
+                        umd::Ux::State = umd::Ux::UX_MAIN_MENU;
+                        umd::Ux::UserInputState = umd::Ux::UX_INPUT_WAIT_FOR_RELEASED;
+                        break;
                     default:
                         // debounce and return to main menu
                         umd::Cart::State = CartState::IDLE;
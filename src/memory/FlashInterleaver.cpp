@@ -0,0 +1,120 @@
+#include "memory/FlashInterleaver.h"
+
+#include <algorithm>
+
+cartridges::FlashInterleaver::FlashInterleaver(IFlashBus& bus)
+    : mBuses{ ChipBus(bus), ChipBus(bus), ChipBus(bus), ChipBus(bus) },
+      mChips{ FlashProgrammer(mBuses[0]), FlashProgrammer(mBuses[1]), FlashProgrammer(mBuses[2]), FlashProgrammer(mBuses[3]) } {
+}
+
+// MARK: Configure()
+void cartridges::FlashInterleaver::Configure(const FlashInfo& info){
+    FlashInfo chipInfo = info;
+    chipInfo.SetChipCount(1);
+
+    mChipCount = std::max((uint8_t)1, std::min(info.ChipCount, MAX_CHIPS));
+    mChipWords = chipInfo.Size >> 1;
+
+    for(uint8_t i = 0; i < mChipCount; i++){
+        mBuses[i].mBase = i * mChipWords;
+        mChips[i].Configure(chipInfo);
+    }
+}
+
+// MARK: BeginProgram()
+cartridges::FlashProgrammer::Status cartridges::FlashInterleaver::BeginProgram(uint32_t wordAddress, const uint8_t *data, uint32_t words){
+    uint8_t chip = ChipAt(wordAddress);
+    return mChips[chip].BeginProgram(wordAddress - mBuses[chip].mBase, data, words);
+}
+
+// MARK: BeginSectorErase()
+cartridges::FlashProgrammer::Status cartridges::FlashInterleaver::BeginSectorErase(uint32_t wordAddress){
+    uint8_t chip = ChipAt(wordAddress);
+    return mChips[chip].BeginSectorErase(wordAddress - mBuses[chip].mBase);
+}
+
+// MARK: BeginChipErase()
+cartridges::FlashProgrammer::Status cartridges::FlashInterleaver::BeginChipErase(){
+    for(uint8_t i = 0; i < mChipCount; i++){
+        mChips[i].BeginChipErase();
+    }
+    return GetStatus();
+}
+
+// MARK: BeginEraseRange()
+cartridges::FlashProgrammer::Status cartridges::FlashInterleaver::BeginEraseRange(uint32_t wordAddress, uint32_t words){
+    uint32_t end = wordAddress + words;
+
+    for(uint8_t i = 0; i < mChipCount; i++){
+        uint32_t chipStart = mBuses[i].mBase;
+        uint32_t chipEnd = chipStart + mChipWords;
+        uint32_t start = std::max(wordAddress, chipStart);
+        uint32_t stop = std::min(end, chipEnd);
+
+        if(start < stop){
+            if(mChips[i].BeginEraseRange(start - chipStart, stop - start) != FlashProgrammer::Status::BUSY
+                && mChips[i].GetStatus() != FlashProgrammer::Status::IDLE){
+                return mChips[i].GetStatus();
+            }
+        }
+    }
+    return GetStatus();
+}
+
+// MARK: Service()
+cartridges::FlashProgrammer::Status cartridges::FlashInterleaver::Service(){
+    for(uint8_t i = 0; i < mChipCount; i++){
+        mChips[i].Service();
+    }
+    return GetStatus();
+}
+
+// MARK: IsToggling()
+bool cartridges::FlashInterleaver::IsToggling(){
+    bool toggling = false;
+    for(uint8_t i = 0; i < mChipCount; i++){
+        toggling |= mChips[i].IsToggling();
+    }
+    return toggling;
+}
+
+// MARK: GetStatus()
+cartridges::FlashProgrammer::Status cartridges::FlashInterleaver::GetStatus() const {
+    FlashProgrammer::Status status = FlashProgrammer::Status::IDLE;
+    for(uint8_t i = 0; i < mChipCount; i++){
+        FlashProgrammer::Status chipStatus = mChips[i].GetStatus();
+        if(chipStatus != FlashProgrammer::Status::IDLE && chipStatus != FlashProgrammer::Status::BUSY){
+            return chipStatus;
+        }
+        if(chipStatus == FlashProgrammer::Status::BUSY){
+            status = chipStatus;
+        }
+    }
+    return status;
+}
+
+// MARK: GetStats()
+cartridges::FlashProgrammer::Stats cartridges::FlashInterleaver::GetStats() const {
+    FlashProgrammer::Stats stats;
+    for(uint8_t i = 0; i < mChipCount; i++){
+        const FlashProgrammer::Stats& chipStats = mChips[i].GetStats();
+        stats.WordsProgrammed += chipStats.WordsProgrammed;
+        stats.WordsSkipped += chipStats.WordsSkipped;
+        stats.SectorsErased += chipStats.SectorsErased;
+        stats.Millis = std::max(stats.Millis, chipStats.Millis);
+    }
+    return stats;
+}
+
+void cartridges::FlashInterleaver::ResetStats(){
+    for(FlashProgrammer& chip : mChips){
+        chip.ResetStats();
+    }
+}
+
+uint8_t cartridges::FlashInterleaver::ChipAt(uint32_t wordAddress) const {
+    if(mChipWords == 0){
+        return 0;
+    }
+    return (uint8_t)std::min(wordAddress / mChipWords, (uint32_t)(mChipCount - 1));
+}
@@ -0,0 +1,435 @@
+#include "memory/FlashProgrammer.h"
+
+#include <algorithm>
+#include <stm32f4xx_hal.h>
+
+cartridges::FlashProgrammer::FlashProgrammer(IFlashBus& bus)
+    : mBus(bus) {
+}
+
+// MARK: Configure()
+void cartridges::FlashProgrammer::Configure(const FlashInfo& info){
+    mInfo = info;
+    mChipSize = info.Size;
+    mBufferWords = info.WriteBufferSize >> 1;
+
+    // prefer the write buffer, it programs a whole page in about the time of a single word
+    if(mBufferWords > 1){
+        mMode = Mode::WRITE_BUFFER;
+    }else if(info.UnlockBypass){
+        mMode = Mode::UNLOCK_BYPASS;
+    }else{
+        mMode = Mode::WORD;
+    }
+
+    // timeouts from the datasheet maximums, the defaults cover chips without timings
+    mProgramTimeoutMs = PROGRAM_TIMEOUT_MS;
+    mSectorEraseTimeoutMs = SECTOR_ERASE_TIMEOUT_MS;
+    mChipEraseTimeoutMs = CHIP_ERASE_TIMEOUT_MS;
+    if(info.HasGeometry()){
+        const FlashTimings& max = info.Chip.Max;
+        uint32_t programUs = mMode == Mode::WRITE_BUFFER ? max.BufferProgramUs : max.WordProgramUs;
+        mProgramTimeoutMs = std::max(PROGRAM_TIMEOUT_MS, (programUs + 999) / 1000 + 1);
+        mSectorEraseTimeoutMs = std::max(PROGRAM_TIMEOUT_MS, max.SectorEraseMs + 1);
+        mChipEraseTimeoutMs = std::max(PROGRAM_TIMEOUT_MS, max.ChipEraseMs + 1);
+    }
+}
+
+// MARK: BeginProgram()
+cartridges::FlashProgrammer::Status cartridges::FlashProgrammer::BeginProgram(uint32_t wordAddress, const uint8_t *data, uint32_t words){
+    if(!IsConfigured()){
+        mStatus = Status::ERROR_NOT_CONFIGURED;
+        return mStatus;
+    }
+
+    mOperation = Operation::PROGRAM;
+    mOpTimeoutMs = mProgramTimeoutMs;
+    pData = data;
+    mBaseAddress = wordAddress;
+    mCursor = 0;
+    mEnd = words;
+    mInFlight = false;
+    mBeginTicks = HAL_GetTick();
+    mStatus = Status::BUSY;
+
+    if(mMode == Mode::UNLOCK_BYPASS && !mBypassActive){
+        EnterUnlockBypass();
+    }
+
+    IssueNext();
+    return mStatus;
+}
+
+// MARK: Service()
+cartridges::FlashProgrammer::Status cartridges::FlashProgrammer::Service(){
+    if(mStatus != Status::BUSY){
+        return mStatus;
+    }
+
+    if(mInFlight){
+        switch(Poll(mPollAddress, mPollValue)){
+            case PollResult::BUSY:
+                if(HAL_GetTick() - mOpStartTicks > mOpTimeoutMs){
+                    return Finish(Status::ERROR_TIMEOUT);
+                }
+                return mStatus;
+            case PollResult::FAILED:
+                return Finish(Status::ERROR_ABORT);
+            case PollResult::READY:
+            default:
+                mInFlight = false;
+                break;
+        }
+    }
+
+    if(mOperation == Operation::ERASE){
+        if(mEraseCursor < mEraseEnd){
+            IssueEraseBatch();
+            return mStatus;
+        }
+        return Finish(Status::IDLE);
+    }
+
+    IssueNext();
+    return mStatus;
+}
+
+// MARK: Program()
+cartridges::FlashProgrammer::Status cartridges::FlashProgrammer::Program(uint32_t wordAddress, const uint8_t *data, uint32_t words){
+    Status status = BeginProgram(wordAddress, data, words);
+    while(status == Status::BUSY){
+        status = Service();
+    }
+    return status;
+}
+
+// MARK: BeginSectorErase()
+cartridges::FlashProgrammer::Status cartridges::FlashProgrammer::BeginSectorErase(uint32_t wordAddress){
+    if(!IsConfigured()){
+        mStatus = Status::ERROR_NOT_CONFIGURED;
+        return mStatus;
+    }
+    return BeginErase(wordAddress, 0x0030, mSectorEraseTimeoutMs);
+}
+
+// MARK: BeginChipErase()
+cartridges::FlashProgrammer::Status cartridges::FlashProgrammer::BeginChipErase(){
+    return BeginErase(CMD_ADDR_1, 0x0010, mChipEraseTimeoutMs);
+}
+
+// MARK: BeginEraseRange()
+cartridges::FlashProgrammer::Status cartridges::FlashProgrammer::BeginEraseRange(uint32_t wordAddress, uint32_t words){
+    if(!IsConfigured()){
+        mStatus = Status::ERROR_NOT_CONFIGURED;
+        return mStatus;
+    }
+
+    uint32_t start = wordAddress << 1;
+    uint32_t end = std::min(mChipSize, (wordAddress + words) << 1);
+    if(start >= end){
+        mStatus = Status::IDLE;
+        return mStatus;
+    }
+
+    const FlashTimings& typical = mInfo.Chip.Typical;
+    uint32_t sectors = mInfo.SectorsInRange(start, end - start);
+    if((start == 0 && end == mChipSize) || (typical.ChipEraseMs != 0 && sectors * typical.SectorEraseMs >= typical.ChipEraseMs)){
+        return BeginChipErase();
+    }
+
+    mOperation = Operation::ERASE;
+    mStatus = Status::BUSY;
+    mEraseCursor = start;
+    mEraseEnd = end;
+    IssueEraseBatch();
+    return mStatus;
+}
+
+/// @brief Issue the 6 cycle erase sequence, DQ7 reads 0 until the erase completes so the poll expects a blank word
+cartridges::FlashProgrammer::Status cartridges::FlashProgrammer::BeginErase(uint32_t wordAddress, uint16_t command, uint32_t timeoutMs){
+    mOperation = Operation::ERASE;
+    mOpTimeoutMs = timeoutMs;
+    mStatus = Status::BUSY;
+    mEraseCursor = 0;
+    mEraseEnd = 0;
+    if(command == 0x0030){
+        mStats.SectorsErased++;
+    }
+
+    Unlock();
+    mBus.FlashWrite(CMD_ADDR_1, 0x0080);
+    Unlock();
+    mBus.FlashWrite(wordAddress, command);
+
+    mPollAddress = command == 0x0010 ? 0 : wordAddress;
+    mPollValue = BLANK_WORD;
+    mInFlight = true;
+    mOpStartTicks = HAL_GetTick();
+    return mStatus;
+}
+
+/// @brief Erase the next sectors of the range. After the first sector erase command the chip waits about 50us for
+/// more sectors before starting, DQ3 goes high once the window is closed. DQ3 is checked before and after each extra
+/// sector, a sector that may have been refused is erased again in the next batch.
+void cartridges::FlashProgrammer::IssueEraseBatch(){
+    uint32_t sectorStart, sectorSize;
+    uint32_t count = 0;
+    uint32_t batch = mInfo.Chip.SectorEraseBatch ? MAX_ERASE_BATCH : 1;
+
+    while(mEraseCursor < mEraseEnd && count < batch && mInfo.SectorAt(mEraseCursor, sectorStart, sectorSize)){
+        uint32_t sectorAddress = sectorStart >> 1;
+
+        if(count == 0){
+            Unlock();
+            mBus.FlashWrite(CMD_ADDR_1, 0x0080);
+            Unlock();
+            mBus.FlashWrite(sectorAddress, 0x0030);
+            mPollAddress = sectorAddress;
+        }else{
+            if(mBus.FlashRead(mPollAddress) & DQ3){
+                break;
+            }
+            mBus.FlashWrite(sectorAddress, 0x0030);
+            if(mBus.FlashRead(mPollAddress) & DQ3){
+                break;
+            }
+        }
+
+        count++;
+        mEraseCursor = sectorStart + sectorSize;
+    }
+
+    if(count == 0){
+        // the range runs past the sector map
+        Finish(Status::ERROR_NOT_CONFIGURED);
+        return;
+    }
+
+    mStats.SectorsErased += count;
+    mPollValue = BLANK_WORD;
+    mOpTimeoutMs = mSectorEraseTimeoutMs * count;
+    mInFlight = true;
+    mOpStartTicks = HAL_GetTick();
+}
+
+// MARK: IsToggling()
+bool cartridges::FlashProgrammer::IsToggling(){
+    uint16_t first = mBus.FlashRead(0);
+    uint16_t second = mBus.FlashRead(0);
+    return ((first ^ second) & DQ6) != 0;
+}
+
+// MARK: QueryCfi()
+bool cartridges::FlashProgrammer::QueryCfi(FlashChip& chip, uint32_t maxSize){
+    mBus.FlashWrite(0, 0x00F0);
+    mBus.FlashWrite(CFI_QUERY_ADDR, 0x0098);
+
+    if(CfiByte(CFI_QRY) != 'Q' || CfiByte(CFI_QRY + 1) != 'R' || CfiByte(CFI_QRY + 2) != 'Y'){
+        mBus.FlashWrite(0, 0x00F0);
+        return false;
+    }
+
+    // the engine only speaks the AMD command set
+    uint16_t commandSet = CfiByte(CFI_COMMAND_SET) | (CfiByte(CFI_COMMAND_SET + 1) << 8);
+    if(commandSet != CFI_AMD_STANDARD){
+        mBus.FlashWrite(0, 0x00F0);
+        return false;
+    }
+
+    chip = FlashChip{};
+    chip.Name = "CFI";
+    chip.SectorEraseBatch = true;
+
+    // sizes are powers of 2, the write buffer size is 0 for chips without one
+    uint8_t sizeExponent = CfiByte(CFI_DEVICE_SIZE);
+    uint16_t bufferExponent = CfiByte(CFI_WRITE_BUFFER_SIZE) | (CfiByte(CFI_WRITE_BUFFER_SIZE + 1) << 8);
+    uint32_t deviceSize = sizeExponent < 32 ? (1UL << sizeExponent) : 0;
+    chip.WriteBufferSize = (bufferExponent > 0 && bufferExponent < 16) ? (uint16_t)(1U << bufferExponent) : 0;
+
+    // word program, buffer program, sector erase and chip erase times
+    uint8_t typical[4], maximum[4];
+    for(uint8_t i = 0; i < 4; i++){
+        typical[i] = CfiByte(CFI_TYP_WORD_PROGRAM + i);
+        maximum[i] = CfiByte(CFI_MAX_WORD_PROGRAM + i);
+    }
+    chip.Typical = { (uint16_t)std::min(CfiTime(typical[0], 0), (uint32_t)0xFFFF), (uint16_t)std::min(CfiTime(typical[1], 0), (uint32_t)0xFFFF),
+        CfiTime(typical[2], 0), CfiTime(typical[3], 0) };
+    chip.Max = { (uint16_t)std::min(CfiTime(typical[0], maximum[0]), (uint32_t)0xFFFF), (uint16_t)std::min(CfiTime(typical[1], maximum[1]), (uint32_t)0xFFFF),
+        CfiTime(typical[2], maximum[2]), CfiTime(typical[3], maximum[3]) };
+
+    // erase block regions, each is 4 bytes: blocks - 1 and block size / 256
+    uint8_t regionCount = std::min(CfiByte(CFI_REGION_COUNT), FlashChip::MAX_REGIONS);
+    for(uint8_t i = 0; i < regionCount; i++){
+        uint32_t field = CFI_REGIONS + (i << 2);
+        chip.Regions[i].Count = (uint16_t)((CfiByte(field) | (CfiByte(field + 1) << 8)) + 1);
+        chip.Regions[i].Size = (uint32_t)(CfiByte(field + 2) | (CfiByte(field + 3) << 8)) << 8;
+    }
+
+    // top boot chips list their regions bottom up in the query, the boot flag of the AMD primary table tells
+    uint32_t primary = CfiByte(CFI_PRIMARY_TABLE) | (CfiByte(CFI_PRIMARY_TABLE + 1) << 8);
+    if(regionCount > 1 && primary != 0 && CfiByte(primary) == 'P' && CfiByte(primary + 1) == 'R' && CfiByte(primary + 2) == 'I'
+        && CfiByte(primary + 0x0F) == CFI_TOP_BOOT){
+        std::reverse(chip.Regions, chip.Regions + regionCount);
+    }
+
+    mBus.FlashWrite(0, 0x00F0);
+
+    // keep the regions that are reachable on the bus
+    uint32_t mapped = 0;
+    for(uint8_t i = 0; i < regionCount && mapped < maxSize && mapped < deviceSize; i++){
+        if(chip.Regions[i].Size == 0){
+            break;
+        }
+        uint32_t reachable = std::min(maxSize, deviceSize) - mapped;
+        if((uint32_t)chip.Regions[i].Count * chip.Regions[i].Size > reachable){
+            chip.Regions[i].Count = (uint16_t)(reachable / chip.Regions[i].Size);
+        }
+        if(chip.Regions[i].Count == 0){
+            break;
+        }
+        mapped += (uint32_t)chip.Regions[i].Count * chip.Regions[i].Size;
+        chip.RegionCount = i + 1;
+    }
+    chip.Size = mapped;
+
+    return chip.Size != 0;
+}
+
+/// @brief Decode a CFI time, the typical time is 2^n us or ms and the maximum is 2^n times the typical
+/// @param typicalExponent typical time field, 0 if not supported
+/// @param maxExponent maximum time field, 0 for the typical time
+uint32_t cartridges::FlashProgrammer::CfiTime(uint8_t typicalExponent, uint8_t maxExponent){
+    if(typicalExponent == 0 || typicalExponent + maxExponent > 31){
+        return 0;
+    }
+    return 1UL << (typicalExponent + maxExponent);
+}
+
+/// @brief Issue the program command for the next non-blank word or page, or complete the operation
+void cartridges::FlashProgrammer::IssueNext(){
+
+    // the chip is erased, blank words don't need any bus cycles
+    while(mCursor < mEnd && DataWord(mCursor) == BLANK_WORD){
+        mCursor++;
+        mStats.WordsSkipped++;
+    }
+
+    if(mCursor >= mEnd){
+        Finish(Status::IDLE);
+        return;
+    }
+
+    uint32_t address = mBaseAddress + mCursor;
+
+    switch(mMode){
+        case Mode::WRITE_BUFFER:
+        {
+            // a buffer load can't cross a write buffer page boundary
+            uint32_t pageEnd = (address | (mBufferWords - 1)) + 1;
+            uint32_t last = std::min(mEnd, mCursor + (pageEnd - address)) - 1;
+
+            // trailing blank words can be left out of the buffer, they are skipped on the next pass
+            while(DataWord(last) == BLANK_WORD){
+                last--;
+            }
+
+            uint32_t count = last - mCursor + 1;
+            uint32_t sectorAddress = address;
+
+            Unlock();
+            mBus.FlashWrite(sectorAddress, 0x0025);
+            mBus.FlashWrite(sectorAddress, (uint16_t)(count - 1));
+            for(uint32_t i = mCursor; i <= last; i++){
+                mBus.FlashWrite(mBaseAddress + i, DataWord(i));
+            }
+            mBus.FlashWrite(sectorAddress, 0x0029);
+
+            mPollAddress = mBaseAddress + last;
+            mPollValue = DataWord(last);
+            mStats.WordsProgrammed += count;
+            mCursor = last + 1;
+            break;
+        }
+        case Mode::UNLOCK_BYPASS:
+            mBus.FlashWrite(address, 0x00A0);
+            mBus.FlashWrite(address, DataWord(mCursor));
+            mPollAddress = address;
+            mPollValue = DataWord(mCursor);
+            mStats.WordsProgrammed++;
+            mCursor++;
+            break;
+        case Mode::WORD:
+        default:
+            Unlock();
+            mBus.FlashWrite(CMD_ADDR_1, 0x00A0);
+            mBus.FlashWrite(address, DataWord(mCursor));
+            mPollAddress = address;
+            mPollValue = DataWord(mCursor);
+            mStats.WordsProgrammed++;
+            mCursor++;
+            break;
+    }
+
+    mInFlight = true;
+    mOpStartTicks = HAL_GetTick();
+}
+
+/// @brief Data polling as per the AMD embedded algorithm flowchart, DQ7 reads the complement of the
+/// programmed data until the operation completes, DQ5 signals a timeout and DQ1 a write buffer abort. DQ1 is only
+/// defined while a write buffer programs, word programs and erases leave it undefined
+cartridges::FlashProgrammer::PollResult cartridges::FlashProgrammer::Poll(uint32_t wordAddress, uint16_t expected){
+    uint16_t status = mBus.FlashRead(wordAddress);
+
+    if(((status ^ expected) & DQ7) == 0){
+        return PollResult::READY;
+    }
+
+    uint16_t failBits = (mOperation == Operation::PROGRAM && mMode == Mode::WRITE_BUFFER) ? (DQ5 | DQ1) : DQ5;
+    if(status & failBits){
+        // DQ7 may have changed at the same time as DQ5/DQ1, read once more before giving up
+        status = mBus.FlashRead(wordAddress);
+        if(((status ^ expected) & DQ7) == 0){
+            return PollResult::READY;
+        }
+        return PollResult::FAILED;
+    }
+
+    return PollResult::BUSY;
+}
+
+cartridges::FlashProgrammer::Status cartridges::FlashProgrammer::Finish(Status status){
+
+    if(mBypassActive){
+        ExitUnlockBypass();
+    }
+
+    if(status == Status::ERROR_ABORT || status == Status::ERROR_TIMEOUT){
+        // a failed or aborted write buffer needs the write-to-buffer-abort reset, it is harmless otherwise
+        Unlock();
+        mBus.FlashWrite(CMD_ADDR_1, 0x00F0);
+    }
+
+    mInFlight = false;
+    if(mOperation == Operation::PROGRAM){
+        mStats.Millis += HAL_GetTick() - mBeginTicks;
+    }
+    mStatus = status;
+    return mStatus;
+}
+
+void cartridges::FlashProgrammer::Unlock(){
+    mBus.FlashWrite(CMD_ADDR_1, 0x00AA);
+    mBus.FlashWrite(CMD_ADDR_2, 0x0055);
+}
+
+void cartridges::FlashProgrammer::EnterUnlockBypass(){
+    Unlock();
+    mBus.FlashWrite(CMD_ADDR_1, 0x0020);
+    mBypassActive = true;
+}
+
+void cartridges::FlashProgrammer::ExitUnlockBypass(){
+    mBus.FlashWrite(0, 0x0090);
+    mBus.FlashWrite(0, 0x0000);
+    mBypassActive = false;
+}
@@ -0,0 +1,284 @@
+#include "patch/BpsPatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+patch::BpsPatch::BpsPatch(IByteSource& source, uint32_t sourceSize, IByteSource& patch, uint32_t patchSize, IByteSource* target)
+    : mSource(source), mSourceSize(sourceSize), mPatchFile(patch), mPatch(patch, patchSize), pTarget(target) {
+}
+
+// MARK: Begin()
+bool patch::BpsPatch::Begin(){
+    uint8_t header[HEADER_SIZE];
+    uint8_t footer[FOOTER_SIZE];
+    uint32_t sourceSize, metadataSize;
+
+    if(mPatch.Size() < HEADER_SIZE + FOOTER_SIZE){
+        return Fail(Error::BAD_HEADER);
+    }
+    mActionsEnd = mPatch.Size() - FOOTER_SIZE;
+    if(!mPatch.Read(header, HEADER_SIZE) || std::memcmp(header, HEADER, HEADER_SIZE) != 0){
+        return Fail(Error::BAD_HEADER);
+    }
+    if(!ReadNumber(sourceSize) || !ReadNumber(mTargetSize) || !ReadNumber(metadataSize)){
+        return Fail(Error::BAD_HEADER);
+    }
+    if(sourceSize != mSourceSize){
+        return Fail(Error::BAD_SOURCE_SIZE);
+    }
+
+    // the metadata is of no use here
+    if(metadataSize > mActionsEnd - mPatch.Position()){
+        return Fail(Error::BAD_HEADER);
+    }
+    mPatch.Seek(mPatch.Position() + metadataSize);
+
+    if(!mPatch.ReadAt(mActionsEnd, footer, FOOTER_SIZE)){
+        return Fail(Error::READ_FAILED);
+    }
+    mSourceCrc = footer[0] | (footer[1] << 8) | (footer[2] << 16) | ((uint32_t)footer[3] << 24);
+    mTargetCrc = footer[4] | (footer[5] << 8) | (footer[6] << 16) | ((uint32_t)footer[7] << 24);
+    mPatchCrc = footer[8] | (footer[9] << 8) | (footer[10] << 16) | ((uint32_t)footer[11] << 24);
+
+    mOutput = 0;
+    mRemaining = 0;
+    mSourceOffset = 0;
+    mTargetOffset = 0;
+    mOutputCrc.Reset();
+    return true;
+}
+
+// MARK: Validate()
+bool patch::BpsPatch::Validate(){
+    uint32_t crc;
+
+    if(mError != Error::NONE){
+        return false;
+    }
+    if(!Checksum(mSource, mSourceSize, crc)){
+        return false;
+    }
+    if(crc != mSourceCrc){
+        return Fail(Error::BAD_SOURCE_CRC);
+    }
+
+    // the patch CRC covers everything but itself
+    if(!Checksum(mPatchFile, mPatch.Size() - 4, crc)){
+        return false;
+    }
+    if(crc != mPatchCrc){
+        return Fail(Error::BAD_PATCH_CRC);
+    }
+    return true;
+}
+
+// MARK: Read()
+uint32_t patch::BpsPatch::Read(uint8_t *buffer, uint32_t size){
+    uint32_t produced = 0;
+
+    if(mError != Error::NONE){
+        return 0;
+    }
+
+    while(produced < size && mOutput < mTargetSize){
+        if(mRemaining == 0 && !NextAction()){
+            return 0;
+        }
+
+        uint32_t count = std::min(mRemaining, size - produced);
+        uint8_t *destination = buffer + produced;
+
+        switch(mAction){
+            case Action::SOURCE_READ:
+                if(mOutput >= mSourceSize || count > mSourceSize - mOutput){
+                    Fail(Error::BAD_RECORD);
+                    return 0;
+                }
+                if(!mSource.ReadAt(mOutput, destination, count)){
+                    Fail(Error::READ_FAILED);
+                    return 0;
+                }
+                break;
+            case Action::TARGET_READ:
+                if(count > mActionsEnd - mPatch.Position() || !mPatch.Read(destination, count)){
+                    Fail(Error::BAD_RECORD);
+                    return 0;
+                }
+                break;
+            case Action::SOURCE_COPY:
+                if(mSourceOffset >= mSourceSize || count > mSourceSize - mSourceOffset){
+                    Fail(Error::BAD_RECORD);
+                    return 0;
+                }
+                if(!mSource.ReadAt(mSourceOffset, destination, count)){
+                    Fail(Error::READ_FAILED);
+                    return 0;
+                }
+                mSourceOffset += count;
+                break;
+            case Action::TARGET_COPY:
+                // an overlapping copy repeats the last bytes, copy at most the distance at a time so every byte
+                // read has been produced already
+                count = std::min(count, mOutput - mTargetOffset);
+                if(!CopyTarget(mTargetOffset, destination, count)){
+                    return 0;
+                }
+                mTargetOffset += count;
+                break;
+        }
+
+        AppendHistory(destination, count);
+        mOutputCrc.Update(destination, count);
+        mOutput += count;
+        mRemaining -= count;
+        produced += count;
+    }
+
+    return produced;
+}
+
+// MARK: Finish()
+bool patch::BpsPatch::Finish(){
+    if(mError != Error::NONE){
+        return false;
+    }
+    if(mOutput != mTargetSize || mRemaining != 0 || mPatch.Position() != mActionsEnd){
+        return Fail(Error::BAD_RECORD);
+    }
+    if(mOutputCrc.Get() != mTargetCrc){
+        return Fail(Error::BAD_TARGET_CRC);
+    }
+    return true;
+}
+
+// MARK: ReadNumber()
+bool patch::BpsPatch::ReadNumber(uint32_t& value){
+    uint64_t data = 0;
+    uint64_t shift = 1;
+
+    while(true){
+        uint8_t byte;
+        if(mPatch.Position() >= mActionsEnd || !mPatch.ReadByte(byte)){
+            return Fail(Error::BAD_RECORD);
+        }
+        data += (byte & 0x7F) * shift;
+        if(byte & 0x80){
+            break;
+        }
+        shift <<= 7;
+        data += shift;
+        if(data > 0xFFFFFFFF){
+            return Fail(Error::BAD_RECORD);
+        }
+    }
+
+    if(data > 0xFFFFFFFF){
+        return Fail(Error::BAD_RECORD);
+    }
+    value = (uint32_t)data;
+    return true;
+}
+
+// MARK: ReadOffset()
+bool patch::BpsPatch::ReadOffset(uint32_t& offset, uint32_t limit){
+    uint32_t data;
+    if(!ReadNumber(data)){
+        return false;
+    }
+
+    // sign in bit 0, relative to the end of the previous copy of the same kind
+    uint32_t distance = data >> 1;
+    if(data & 1){
+        if(distance > offset){
+            return Fail(Error::BAD_RECORD);
+        }
+        offset -= distance;
+    }else{
+        if(distance >= limit - offset){
+            return Fail(Error::BAD_RECORD);
+        }
+        offset += distance;
+    }
+    return true;
+}
+
+// MARK: NextAction()
+bool patch::BpsPatch::NextAction(){
+    uint32_t data;
+    if(!ReadNumber(data)){
+        return false;
+    }
+
+    mAction = (Action)(data & 3);
+    mRemaining = (data >> 2) + 1;
+    if(mRemaining > mTargetSize - mOutput){
+        return Fail(Error::BAD_RECORD);
+    }
+
+    switch(mAction){
+        case Action::SOURCE_COPY:
+            return ReadOffset(mSourceOffset, mSourceSize);
+        case Action::TARGET_COPY:
+            // can only copy what was produced already
+            return ReadOffset(mTargetOffset, mOutput);
+        default:
+            return true;
+    }
+}
+
+// MARK: CopyTarget()
+bool patch::BpsPatch::CopyTarget(uint32_t offset, uint8_t *buffer, uint32_t size){
+    // bytes older than the history are read back from the target
+    uint32_t oldest = mOutput > HISTORY_SIZE ? mOutput - HISTORY_SIZE : 0;
+    if(offset < oldest){
+        uint32_t count = std::min(size, oldest - offset);
+        if(pTarget == nullptr){
+            return Fail(Error::BAD_RECORD);
+        }
+        if(!pTarget->ReadAt(offset, buffer, count)){
+            return Fail(Error::READ_FAILED);
+        }
+        offset += count;
+        buffer += count;
+        size -= count;
+    }
+
+    while(size != 0){
+        uint32_t index = offset & (HISTORY_SIZE - 1);
+        uint32_t count = std::min(size, HISTORY_SIZE - index);
+        std::memcpy(buffer, mHistory + index, count);
+        offset += count;
+        buffer += count;
+        size -= count;
+    }
+    return true;
+}
+
+// MARK: AppendHistory()
+void patch::BpsPatch::AppendHistory(const uint8_t *data, uint32_t size){
+    uint32_t offset = mOutput;
+    while(size != 0){
+        uint32_t index = offset & (HISTORY_SIZE - 1);
+        uint32_t count = std::min(size, HISTORY_SIZE - index);
+        std::memcpy(mHistory + index, data, count);
+        offset += count;
+        data += count;
+        size -= count;
+    }
+}
+
+// MARK: Checksum()
+bool patch::BpsPatch::Checksum(IByteSource& source, uint32_t size, uint32_t& crc){
+    uint8_t chunk[VALIDATE_CHUNK_SIZE];
+    Crc32 calculator;
+
+    for(uint32_t offset = 0; offset < size; offset += VALIDATE_CHUNK_SIZE){
+        uint32_t count = std::min(VALIDATE_CHUNK_SIZE, size - offset);
+        if(!source.ReadAt(offset, chunk, count)){
+            return Fail(Error::READ_FAILED);
+        }
+        calculator.Update(chunk, count);
+    }
+    crc = calculator.Get();
+    return true;
+}
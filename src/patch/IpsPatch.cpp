@@ -0,0 +1,161 @@
+#include "patch/IpsPatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+patch::IpsPatch::IpsPatch(IByteSource& source, uint32_t sourceSize, IByteSource& patch, uint32_t patchSize)
+    : mSource(source), mSourceSize(sourceSize), mPatch(patch, patchSize) {
+}
+
+// MARK: Begin()
+bool patch::IpsPatch::Begin(){
+    uint8_t header[HEADER_SIZE];
+    if(!mPatch.Read(header, HEADER_SIZE) || std::memcmp(header, HEADER, HEADER_SIZE) != 0){
+        return Fail(Error::BAD_HEADER);
+    }
+
+    // walk the records once to find the target size and make sure they can be streamed
+    Record record;
+    bool end = false;
+    uint32_t previousEnd = 0;
+    mTargetSize = mSourceSize;
+    while(true){
+        if(!ReadRecord(record, end)){
+            return false;
+        }
+        if(end){
+            break;
+        }
+        if(record.Offset < previousEnd){
+            return Fail(Error::UNSORTED_RECORDS);
+        }
+        previousEnd = record.Offset + record.Length;
+        mTargetSize = std::max(mTargetSize, previousEnd);
+    }
+
+    // optional truncation of the target after the EOF marker
+    uint32_t truncate;
+    if(mPatch.Position() + 3 <= mPatch.Size() && ReadNumber(3, truncate)){
+        mTargetSize = truncate;
+    }
+
+    mOutput = 0;
+    mPatch.Seek(HEADER_SIZE);
+    return NextRecord();
+}
+
+// MARK: Read()
+uint32_t patch::IpsPatch::Read(uint8_t *buffer, uint32_t size){
+    if(mError != Error::NONE){
+        return 0;
+    }
+
+    uint32_t count = std::min(size, mTargetSize - mOutput);
+    if(count == 0){
+        return 0;
+    }
+
+    // source data, the target may be longer than the source in which case it is extended with zeros
+    uint32_t fromSource = mOutput < mSourceSize ? std::min(count, mSourceSize - mOutput) : 0;
+    if(fromSource != 0 && !mSource.ReadAt(mOutput, buffer, fromSource)){
+        Fail(Error::READ_FAILED);
+        return 0;
+    }
+    std::memset(buffer + fromSource, 0, count - fromSource);
+
+    // overlay the records falling in this chunk
+    uint32_t end = mOutput + count;
+    while(mHasRecord && mRecord.Offset + mApplied < end){
+        uint32_t from = mRecord.Offset + mApplied;
+        uint32_t length = std::min(mRecord.Length - mApplied, end - from);
+        uint8_t *destination = buffer + (from - mOutput);
+
+        if(mRecord.Rle){
+            std::memset(destination, mRecord.Value, length);
+        }else if(!mPatch.ReadAt(mRecord.DataPosition + mApplied, destination, length)){
+            Fail(Error::READ_FAILED);
+            return 0;
+        }
+
+        mApplied += length;
+        if(mApplied == mRecord.Length && !NextRecord()){
+            return 0;
+        }
+    }
+
+    mOutput = end;
+    return count;
+}
+
+// MARK: Finish()
+bool patch::IpsPatch::Finish(){
+    return mError == Error::NONE && mOutput == mTargetSize;
+}
+
+// MARK: ReadNumber()
+bool patch::IpsPatch::ReadNumber(uint8_t bytes, uint32_t& value){
+    value = 0;
+    for(uint8_t i = 0; i < bytes; i++){
+        uint8_t byte;
+        if(!mPatch.ReadByte(byte)){
+            return Fail(Error::BAD_RECORD);
+        }
+        value = (value << 8) | byte;
+    }
+    return true;
+}
+
+// MARK: ReadRecord()
+bool patch::IpsPatch::ReadRecord(Record& record, bool& end){
+    uint32_t length;
+
+    end = false;
+    if(!ReadNumber(3, record.Offset)){
+        return false;
+    }
+    if(record.Offset == EOF_MARKER){
+        end = true;
+        return true;
+    }
+
+    if(!ReadNumber(2, length)){
+        return false;
+    }
+
+    if(length == 0){
+        // run length encoded record
+        uint32_t value;
+        if(!ReadNumber(2, length) || !ReadNumber(1, value)){
+            return false;
+        }
+        if(length == 0){
+            return Fail(Error::BAD_RECORD);
+        }
+        record.Rle = true;
+        record.Value = (uint8_t)value;
+        record.DataPosition = 0;
+    }else{
+        record.Rle = false;
+        record.DataPosition = mPatch.Position();
+        if(length > mPatch.Size() - record.DataPosition){
+            return Fail(Error::BAD_RECORD);
+        }
+        mPatch.Seek(record.DataPosition + length);
+    }
+
+    record.Length = length;
+    return true;
+}
+
+// MARK: NextRecord()
+bool patch::IpsPatch::NextRecord(){
+    bool end;
+    mApplied = 0;
+    if(!ReadRecord(mRecord, end)){
+        mHasRecord = false;
+        return false;
+    }
+    // records past a truncated target are never reached
+    mHasRecord = !end && mRecord.Offset < mTargetSize;
+    return true;
+}
@@ -0,0 +1,33 @@
+#include "pipeline/BufferPool.h"
+
+// MARK: Acquire()
+cartridges::Array* pipeline::BufferPool::Acquire(){
+    for(uint8_t i = 0; i < SIZE; i++){
+        if((mInUse & (1 << i)) == 0){
+            mInUse |= (1 << i);
+            return &mArrays[i];
+        }
+    }
+    return nullptr;
+}
+
+// MARK: Release()
+void pipeline::BufferPool::Release(cartridges::Array* array){
+    for(uint8_t i = 0; i < SIZE; i++){
+        if(array == &mArrays[i]){
+            mInUse &= ~(1 << i);
+            return;
+        }
+    }
+}
+
+// MARK: Available()
+uint8_t pipeline::BufferPool::Available() const{
+    uint8_t count = 0;
+    for(uint8_t i = 0; i < SIZE; i++){
+        if((mInUse & (1 << i)) == 0){
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,66 @@
+#include "pipeline/CartridgeSource.h"
+
+#include <algorithm>
+
+// MARK: Configure()
+void pipeline::CartridgeSource::Configure(cartridges::Cartridge& cartridge, uint8_t memTypeIndex, uint32_t address, uint32_t length, Mode mode){
+    pCartridge = &cartridge;
+    mMemTypeIndex = memTypeIndex;
+    mAddress = address;
+    mRemaining = length;
+    mMode = mode;
+    mRetryHead = 0;
+    mRetryCount = 0;
+    mLostRetries = 0;
+}
+
+// MARK: Process()
+bool pipeline::CartridgeSource::Process(Buffer& buffer){
+    if(pCartridge == nullptr || mRemaining == 0){
+        return false;
+    }
+
+    // the buffers come from a pool, each one is set up for its own transfer
+    cartridges::Array& array = *buffer.pArray;
+    array.SetTransferSize(std::min((uint32_t)array.Size(), mRemaining));
+    buffer.Address = mAddress;
+
+    switch(mMode){
+        case Mode::VERIFIED:{
+            uint8_t retries = pCartridge->ReadMemoryVerified(mAddress, array, mMemTypeIndex, cartridges::Cartridge::ReadOptions::BUS_ORDER);
+            if(retries != 0){
+                // the oldest entry makes room
+                if(mRetryCount == RETRY_QUEUE_SIZE){
+                    mRetryHead = (mRetryHead + 1) % RETRY_QUEUE_SIZE;
+                    mRetryCount--;
+                    mLostRetries++;
+                }
+                mRetries[(mRetryHead + mRetryCount) % RETRY_QUEUE_SIZE] = {mAddress, retries};
+                mRetryCount++;
+            }
+            break;
+        }
+        case Mode::IDENTIFY:
+            pCartridge->Identify(mAddress, array, cartridges::Cartridge::ReadOptions::BUS_ORDER);
+            break;
+        default:
+            pCartridge->ReadMemory(mAddress, array, mMemTypeIndex, cartridges::Cartridge::ReadOptions::BUS_ORDER);
+            break;
+    }
+
+    mAddress += array.AvailableSize();
+    mRemaining -= array.AvailableSize();
+    return array.AvailableSize() != 0;
+}
+
+// MARK: TakeRetry()
+bool pipeline::CartridgeSource::TakeRetry(Retry& retry){
+    if(mRetryCount == 0){
+        return false;
+    }
+
+    retry = mRetries[mRetryHead];
+    mRetryHead = (mRetryHead + 1) % RETRY_QUEUE_SIZE;
+    mRetryCount--;
+    return true;
+}
@@ -0,0 +1,36 @@
+#include "pipeline/ChecksumStage.h"
+
+// MARK: Configure()
+void pipeline::ChecksumStage::Configure(cartridges::Cartridge& cartridge, uint32_t blockSize, uint32_t endAddress){
+    pCartridge = &cartridge;
+    mBlockSize = blockSize;
+    mEndAddress = endAddress;
+}
+
+// MARK: Begin()
+bool pipeline::ChecksumStage::Begin(){
+    if(pCartridge == nullptr){
+        return false;
+    }
+    pCartridge->ResetChecksumCalculator();
+    mBlockReady = false;
+    mPendingBytes = 0;
+    return true;
+}
+
+// MARK: Process()
+bool pipeline::ChecksumStage::Process(Buffer& buffer){
+    pCartridge->AccumulateChecksum(*buffer.pArray);
+    mPendingBytes += buffer.pArray->AvailableSize();
+
+    uint32_t end = buffer.Address + buffer.pArray->AvailableSize();
+    mBlockReady = mBlockSize != 0 && ((end % mBlockSize) == 0 || end == mEndAddress);
+    if(mBlockReady){
+        mBlockChecksum = pCartridge->GetAccumulatedChecksum();
+        mBlockBytes = mPendingBytes;
+        mBlockEnd = end;
+        mPendingBytes = 0;
+        pCartridge->ResetChecksumCalculator();
+    }
+    return true;
+}
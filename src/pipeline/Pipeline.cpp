@@ -0,0 +1,85 @@
+#include "pipeline/Pipeline.h"
+
+#include <Arduino.h>
+
+// MARK: Reset()
+void pipeline::Pipeline::Reset(Source& source){
+    pSource = &source;
+    mStageCount = 0;
+}
+
+// MARK: Add()
+bool pipeline::Pipeline::Add(Stage& stage){
+    if(mStageCount == MAX_STAGES){
+        return false;
+    }
+    mStages[mStageCount++] = &stage;
+    return true;
+}
+
+// MARK: Begin()
+bool pipeline::Pipeline::Begin(){
+    if(pSource == nullptr){
+        return false;
+    }
+    for(uint8_t i = 0; i <= mStageCount; i++){
+        StageAt(i).ResetStats();
+        if(!StageAt(i).Begin()){
+            return false;
+        }
+    }
+    return true;
+}
+
+// MARK: Step()
+bool pipeline::Pipeline::Step(){
+    Buffer buffer;
+    buffer.pArray = mPool.Acquire();
+    if(buffer.pArray == nullptr){
+        return false;
+    }
+
+    bool result = true;
+    for(uint8_t i = 0; i <= mStageCount && result; i++){
+        uint32_t start = micros();
+        result = StageAt(i).Process(buffer);
+        StageAt(i).Account(buffer.pArray->AvailableSize(), micros() - start);
+    }
+
+    mPool.Release(buffer.pArray);
+    return result;
+}
+
+// MARK: Finish()
+bool pipeline::Pipeline::Finish(){
+    bool result = true;
+    for(uint8_t i = 0; i <= mStageCount && pSource != nullptr; i++){
+        result = StageAt(i).Finish() && result;
+    }
+    return result;
+}
+
+// MARK: Run()
+bool pipeline::Pipeline::Run(){
+    bool result = Begin();
+    while(result && !IsDone()){
+        result = Step();
+    }
+    return Finish() && result;
+}
+
+// MARK: GetSlowestStage()
+const pipeline::Stage* pipeline::Pipeline::GetSlowestStage() const{
+    const Stage* slowest = nullptr;
+    uint64_t worst = 0;
+    for(uint8_t i = 0; i <= mStageCount && pSource != nullptr; i++){
+        const StageStats& stats = StageAt(i).GetStats();
+        // compare microseconds per byte without dividing
+        uint64_t cost = stats.Bytes == 0 ? 0 : ((uint64_t)stats.Micros << 20) / stats.Bytes;
+        if(slowest == nullptr || cost > worst){
+            slowest = &StageAt(i);
+            worst = cost;
+        }
+    }
+    return slowest;
+}
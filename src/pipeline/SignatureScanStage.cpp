@@ -0,0 +1,142 @@
+#include "pipeline/SignatureScanStage.h"
+
+#include <cstring>
+
+// MARK: Configure()
+bool pipeline::SignatureScanStage::Configure(const std::vector<const char *>& patterns){
+    mNodes[ROOT] = {};
+    mRootNext.fill(ROOT);
+    mNodeCount = 1;
+    mPatternCount = 0;
+    mHits.fill(Hit());
+
+    if(patterns.size() > MAX_PATTERNS){
+        return false;
+    }
+
+    // trie of the patterns
+    for(const char *pattern : patterns){
+        size_t length = std::strlen(pattern);
+        if(length == 0 || length > UINT8_MAX){
+            mPatternCount = 0;
+            return false;
+        }
+
+        uint16_t node = ROOT;
+        for(size_t i = 0; i < length; i++){
+            uint8_t c = (uint8_t)pattern[i];
+            uint16_t next = Child(node, c);
+            if(next == ROOT){
+                if(mNodeCount == MAX_STATES){
+                    mPatternCount = 0;
+                    return false;
+                }
+                next = mNodeCount++;
+                mNodes[next] = {ROOT, mNodes[node].FirstChild, ROOT, 0, c};
+                mNodes[node].FirstChild = next;
+                if(node == ROOT){
+                    mRootNext[c] = next;
+                }
+            }
+            node = next;
+        }
+
+        mNodes[node].Output |= (uint16_t)(1 << mPatternCount);
+        mPatterns[mPatternCount] = pattern;
+        mLengths[mPatternCount] = (uint8_t)length;
+        mPatternCount++;
+    }
+
+    // fail links in breadth first order, a node's link is always to a shallower node that is already done
+    std::array<uint16_t, MAX_STATES> queue;
+    uint16_t head = 0;
+    uint16_t tail = 0;
+    for(uint16_t child = mNodes[ROOT].FirstChild; child != ROOT; child = mNodes[child].NextSibling){
+        queue[tail++] = child;
+    }
+
+    while(head != tail){
+        uint16_t node = queue[head++];
+        for(uint16_t child = mNodes[node].FirstChild; child != ROOT; child = mNodes[child].NextSibling){
+            uint8_t c = mNodes[child].Char;
+            uint16_t fail = mNodes[node].Fail;
+            while(fail != ROOT && Child(fail, c) == ROOT){
+                fail = mNodes[fail].Fail;
+            }
+            mNodes[child].Fail = Child(fail, c);
+            mNodes[child].Output |= mNodes[mNodes[child].Fail].Output;
+            queue[tail++] = child;
+        }
+    }
+    return true;
+}
+
+// MARK: Begin()
+bool pipeline::SignatureScanStage::Begin(){
+    mState = ROOT;
+    mHits.fill(Hit());
+    return true;
+}
+
+// MARK: Process()
+bool pipeline::SignatureScanStage::Process(Buffer& buffer){
+    const uint8_t *data = buffer.pArray->Data();
+    uint32_t size = buffer.pArray->AvailableSize();
+    uint16_t state = mState;
+
+    if(mPatternCount == 0){
+        return true;
+    }
+
+    for(uint32_t i = 0; i < size; i++){
+        uint8_t c = data[i];
+        uint16_t next = ROOT;
+
+        while(state != ROOT && (next = Child(state, c)) == ROOT){
+            state = mNodes[state].Fail;
+        }
+        state = state == ROOT ? mRootNext[c] : next;
+
+        if(mNodes[state].Output != 0){
+            Record(state, buffer.Address + i + 1);
+        }
+    }
+
+    mState = state;
+    return true;
+}
+
+// MARK: GetFoundCount()
+uint8_t pipeline::SignatureScanStage::GetFoundCount() const{
+    uint8_t found = 0;
+    for(uint8_t i = 0; i < mPatternCount; i++){
+        found += mHits[i].Count != 0 ? 1 : 0;
+    }
+    return found;
+}
+
+// MARK: Child()
+uint16_t pipeline::SignatureScanStage::Child(uint16_t node, uint8_t c) const{
+    if(node == ROOT){
+        return mRootNext[c];
+    }
+    for(uint16_t child = mNodes[node].FirstChild; child != ROOT; child = mNodes[child].NextSibling){
+        if(mNodes[child].Char == c){
+            return child;
+        }
+    }
+    return ROOT;
+}
+
+// MARK: Record()
+void pipeline::SignatureScanStage::Record(uint16_t node, uint32_t endAddress){
+    uint16_t output = mNodes[node].Output;
+    for(uint8_t i = 0; output != 0; i++, output >>= 1){
+        if((output & 1) == 0){
+            continue;
+        }
+        if(mHits[i].Count++ == 0){
+            mHits[i].FirstAddress = endAddress - mLengths[i];
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#include "pipeline/TeeSink.h"
+
+#include <Arduino.h>
+
+// MARK: Begin()
+bool pipeline::TeeSink::Begin(){
+    mFirst.ResetStats();
+    mSecond.ResetStats();
+    return mFirst.Begin() && mSecond.Begin();
+}
+
+// MARK: Process()
+bool pipeline::TeeSink::Process(Buffer& buffer){
+    return ProcessBranch(mFirst, buffer) && ProcessBranch(mSecond, buffer);
+}
+
+// MARK: Finish()
+bool pipeline::TeeSink::Finish(){
+    // both branches release what they hold whatever the other one did
+    bool first = mFirst.Finish();
+    bool second = mSecond.Finish();
+    return first && second;
+}
+
+// MARK: GetSlowerBranch()
+const pipeline::Stage& pipeline::TeeSink::GetSlowerBranch() const{
+    return mSecond.GetStats().Micros > mFirst.GetStats().Micros ? mSecond : mFirst;
+}
+
+// MARK: ProcessBranch()
+bool pipeline::TeeSink::ProcessBranch(Stage& branch, Buffer& buffer){
+    uint32_t start = micros();
+    bool result = branch.Process(buffer);
+    branch.Account(buffer.pArray->AvailableSize(), micros() - start);
+    return result;
+}
@@ -0,0 +1,56 @@
+#include "pipeline/UsbSink.h"
+
+#include <algorithm>
+
+// MARK: Configure()
+void pipeline::UsbSink::Configure(const std::string& name, uint32_t size){
+    mName = name;
+    mSize = size;
+}
+
+// MARK: Begin()
+bool pipeline::UsbSink::Begin(){
+    // with no host the port swallows every write, the dump would wait on it forever
+    if(!mPort){
+        return false;
+    }
+
+    mPort.printf("UMD DUMP %s %lu\r\n", mName.c_str(), (unsigned long)mSize);
+    return true;
+}
+
+// MARK: Process()
+bool pipeline::UsbSink::Process(Buffer& buffer){
+    const uint8_t *data = buffer.pArray->Data();
+    uint32_t remaining = buffer.pArray->AvailableSize();
+    uint32_t lastProgress = HAL_GetTick();
+
+    // only write what fits, a blocking write would hang on a host that went away
+    while(remaining != 0){
+        int room = mPort.availableForWrite();
+        if(room > 0){
+            size_t written = mPort.write(data, std::min((uint32_t)room, remaining));
+            data += written;
+            remaining -= written;
+            // a port without a host takes nothing, that isn't progress
+            if(written > 0){
+                lastProgress = HAL_GetTick();
+                continue;
+            }
+        }
+        if(HAL_GetTick() - lastProgress > WRITE_TIMEOUT_MS){
+            return false;
+        }
+    }
+    return true;
+}
+
+// MARK: SendResult()
+void pipeline::UsbSink::SendResult(bool success, uint32_t checksum){
+    if(success){
+        mPort.printf("\r\nUMD END %08lX\r\n", (unsigned long)checksum);
+    }else{
+        mPort.printf("\r\nUMD FAIL\r\n");
+    }
+    mPort.flush();
+}
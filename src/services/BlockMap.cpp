@@ -0,0 +1,128 @@
+#include "services/BlockMap.h"
+
+#include <algorithm>
+
+// MARK: Create()
+bool umd::BlockMap::Create(const std::string& path, uint32_t totalSize, uint32_t resumeBlocks){
+    Close();
+
+    if(resumeBlocks == 0 && SD.exists(path.c_str())){
+        SD.remove(path.c_str());
+    }
+    mFile = SD.open(path.c_str(), FILE_WRITE);
+    if(!mFile){
+        return false;
+    }
+
+    mWriting = true;
+    mBufferBlock = resumeBlocks;
+    mBufferCount = 0;
+
+    if(resumeBlocks != 0){
+        // the map must be the one started for the same memory
+        bool match = mFile.seek(0) && mFile.read(&mHeader, sizeof(Header)) == (int)sizeof(Header) &&
+            mHeader.Magic == MAGIC && mHeader.BlockSize == BLOCK_SIZE && mHeader.TotalSize == totalSize &&
+            resumeBlocks <= GetBlockCount() && mFile.size() >= sizeof(Header) + resumeBlocks * sizeof(uint32_t);
+        if(!match){
+            Close();
+        }
+        return match;
+    }
+
+    mHeader = {MAGIC, BLOCK_SIZE, totalSize, 0};
+    if(mFile.write(reinterpret_cast<const uint8_t *>(&mHeader), sizeof(Header)) != sizeof(Header)){
+        Close();
+        return false;
+    }
+    return true;
+}
+
+// MARK: Add()
+bool umd::BlockMap::Add(uint32_t checksum){
+    mBuffer[mBufferCount++] = checksum;
+    if(mBufferCount == BUFFER_ENTRIES){
+        return Sync();
+    }
+    return true;
+}
+
+// MARK: Sync()
+bool umd::BlockMap::Sync(){
+    if(!mFile || !mWriting){
+        return false;
+    }
+    if(mBufferCount != 0){
+        uint32_t bytes = mBufferCount * sizeof(uint32_t);
+        if(!mFile.seek(sizeof(Header) + mBufferBlock * sizeof(uint32_t)) ||
+            mFile.write(reinterpret_cast<const uint8_t *>(mBuffer.data()), bytes) != bytes){
+            return false;
+        }
+        mBufferBlock += mBufferCount;
+        mBufferCount = 0;
+    }
+    mFile.flush();
+    return true;
+}
+
+// MARK: Finish()
+bool umd::BlockMap::Finish(uint32_t checksum){
+    if(!Sync()){
+        Close();
+        return false;
+    }
+
+    mHeader.Checksum = checksum;
+    bool result = mFile.seek(0) && mFile.write(reinterpret_cast<const uint8_t *>(&mHeader), sizeof(Header)) == sizeof(Header);
+    Close();
+    return result;
+}
+
+// MARK: Open()
+bool umd::BlockMap::Open(const std::string& path){
+    Close();
+
+    mFile = SD.open(path.c_str(), FILE_READ);
+    if(!mFile){
+        return false;
+    }
+
+    bool valid = mFile.read(&mHeader, sizeof(Header)) == (int)sizeof(Header) && mHeader.Magic == MAGIC &&
+        mHeader.BlockSize == BLOCK_SIZE && mFile.size() >= sizeof(Header) + GetBlockCount() * sizeof(uint32_t);
+    if(!valid){
+        Close();
+    }
+    return valid;
+}
+
+// MARK: Get()
+bool umd::BlockMap::Get(uint32_t block, uint32_t& checksum){
+    if(!mFile || block >= GetBlockCount()){
+        return false;
+    }
+
+    if(block < mBufferBlock || block >= mBufferBlock + mBufferCount){
+        mBufferBlock = block;
+        mBufferCount = std::min(BUFFER_ENTRIES, GetBlockCount() - block);
+        int bytes = mBufferCount * sizeof(uint32_t);
+        if(!mFile.seek(sizeof(Header) + block * sizeof(uint32_t)) || mFile.read(mBuffer.data(), bytes) != bytes){
+            mBufferCount = 0;
+            return false;
+        }
+    }
+
+    checksum = mBuffer[block - mBufferBlock];
+    return true;
+}
+
+// MARK: Close()
+void umd::BlockMap::Close(){
+    if(mFile){
+        if(mWriting){
+            Sync();
+        }
+        mFile.close();
+    }
+    mWriting = false;
+    mBufferBlock = 0;
+    mBufferCount = 0;
+}
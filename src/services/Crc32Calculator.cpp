@@ -57,4 +57,52 @@ uint32_t Crc32Calculator::Accumulate(uint32_t pBuffer[], uint32_t length)
     // Pat Riley GM MK-1201 -00 HW CRC32 calculation = FA1AC95B
     // Pat Riley CRC on first 512 bytes = E6CF6C16
     // Uses CRC-32 (Ethernet) polynomial: 0x4C11DB7
-}
\ No newline at end of file
+}
+
+/// @brief The STM32 CRC unit is a non-reflected CRC-32 with an init value of 0xFFFFFFFF and no final xor.
+/// Because the CRC is linear, CRC(A|B) = CRC(A) * x^(8*len(B)) ^ CRC(B) ^ INIT * x^(8*len(B)), i.e. the init
+/// value that B was started with has to be cancelled out before A is shifted over B. No data is re-read.
+/// @param crcA CRC of block A, from a reset
+/// @param crcB CRC of block B, from a reset
+/// @param lengthB length of block B in bytes, multiple of 4 as the hardware only takes words
+/// @return CRC of A followed by B
+uint32_t Crc32Calculator::Combine(uint32_t crcA, uint32_t crcB, uint32_t lengthB)
+{
+    if (lengthB == 0)
+    {
+        return crcA;
+    }
+    return MultiplyModP(crcA ^ CRC32_INIT, XPow8N(lengthB)) ^ crcB;
+}
+
+uint32_t Crc32Calculator::MultiplyModP(uint32_t a, uint32_t b)
+{
+    uint32_t product = 0;
+    // walk b from the x^31 coefficient down, Horner style
+    for (uint32_t mask = 0x80000000; mask != 0; mask >>= 1)
+    {
+        product = (product & 0x80000000) ? (product << 1) ^ CRC32_POLY : (product << 1);
+        if (b & mask)
+        {
+            product ^= a;
+        }
+    }
+    return product;
+}
+
+uint32_t Crc32Calculator::XPow8N(uint32_t length)
+{
+    // square and multiply, starting from x^8
+    uint32_t result = 0x00000001; // x^0
+    uint32_t square = 0x00000100; // x^8
+    while (length != 0)
+    {
+        if (length & 1)
+        {
+            result = MultiplyModP(result, square);
+        }
+        square = MultiplyModP(square, square);
+        length >>= 1;
+    }
+    return result;
+}
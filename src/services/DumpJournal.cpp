@@ -0,0 +1,57 @@
+#include "services/DumpJournal.h"
+#include "patch/Crc32.h"
+
+#include <cstddef>
+
+// MARK: Load()
+bool umd::DumpJournal::Load(const std::string& path, Record& record){
+    File file = SD.open(path.c_str(), FILE_READ);
+    if(!file){
+        return false;
+    }
+    bool result = file.read(&record, sizeof(Record)) == (int)sizeof(Record);
+    file.close();
+
+    return result && record.Magic == MAGIC && record.RecordCrc == RecordCrc(record)
+        && record.FileName[MAX_FILE_NAME - 1] == '\0';
+}
+
+// MARK: Begin()
+bool umd::DumpJournal::Begin(const std::string& path){
+    mPath = path;
+    mFile = SD.open(path.c_str(), FILE_WRITE);
+    return (bool)mFile;
+}
+
+// MARK: Commit()
+bool umd::DumpJournal::Commit(Record& record){
+    if(!mFile){
+        return false;
+    }
+    record.Magic = MAGIC;
+    record.RecordCrc = RecordCrc(record);
+
+    // the record always fits in one sector so it is rewritten in place
+    if(!mFile.seek(0) || mFile.write(reinterpret_cast<const uint8_t *>(&record), sizeof(Record)) != sizeof(Record)){
+        return false;
+    }
+    mFile.flush();
+    return true;
+}
+
+// MARK: End()
+void umd::DumpJournal::End(bool completed){
+    if(mFile){
+        mFile.close();
+    }
+    if(completed && !mPath.empty()){
+        SD.remove(mPath.c_str());
+    }
+}
+
+// MARK: RecordCrc()
+uint32_t umd::DumpJournal::RecordCrc(const Record& record){
+    patch::Crc32 crc;
+    crc.Update(reinterpret_cast<const uint8_t *>(&record), offsetof(Record, RecordCrc));
+    return crc.Get();
+}
@@ -0,0 +1,91 @@
+#include "services/LzCodec.h"
+
+#include <cstring>
+
+// MARK: Compress()
+uint32_t umd::LzCodec::Compress(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t capacity){
+    uint8_t *op = dst;
+    const uint8_t *end = dst + capacity;
+    uint32_t anchor = 0;
+    uint32_t ip = 0;
+
+    if(size > MAX_BLOCK_SIZE){
+        return 0;
+    }
+
+    // positions are validated by comparing the data, stale entries only cost a compare
+    mTable.fill(0);
+
+    while(size > MATCH_FIND_LIMIT && ip < size - MATCH_FIND_LIMIT){
+        uint32_t sequence = Read32(src + ip);
+        uint32_t h = Hash(sequence);
+        uint32_t ref = mTable[h];
+        mTable[h] = (uint16_t)ip;
+
+        if(ref >= ip || Read32(src + ref) != sequence){
+            ip++;
+            continue;
+        }
+
+        uint32_t length = MIN_MATCH;
+        while(ip + length < size - LAST_LITERALS && src[ref + length] == src[ip + length]){
+            length++;
+        }
+
+        if(!Emit(src + anchor, ip - anchor, ip - ref, length, op, end)){
+            return 0;
+        }
+        ip += length;
+        anchor = ip;
+    }
+
+    if(!Emit(src + anchor, size - anchor, 0, 0, op, end)){
+        return 0;
+    }
+    return (uint32_t)(op - dst);
+}
+
+// MARK: Read32()
+uint32_t umd::LzCodec::Read32(const uint8_t *p){
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// MARK: Emit()
+bool umd::LzCodec::Emit(const uint8_t *literals, uint32_t literalLength, uint32_t offset, uint32_t matchLength, uint8_t *&op, const uint8_t *end){
+    // token, length extensions, literals and offset
+    uint32_t needed = 1 + literalLength + literalLength / 255 + 1 + (matchLength != 0 ? 2 + matchLength / 255 + 1 : 0);
+    if(needed > (uint32_t)(end - op)){
+        return false;
+    }
+
+    uint32_t matchCode = matchLength != 0 ? matchLength - MIN_MATCH : 0;
+    uint8_t *token = op++;
+    *token = (uint8_t)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+    if(literalLength >= 15){
+        uint32_t rest = literalLength - 15;
+        for(; rest >= 255; rest -= 255){
+            *op++ = 255;
+        }
+        *op++ = (uint8_t)rest;
+    }
+    std::memcpy(op, literals, literalLength);
+    op += literalLength;
+
+    if(matchLength == 0){
+        return true;
+    }
+
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    if(matchCode >= 15){
+        uint32_t rest = matchCode - 15;
+        for(; rest >= 255; rest -= 255){
+            *op++ = 255;
+        }
+        *op++ = (uint8_t)rest;
+    }
+    return true;
+}
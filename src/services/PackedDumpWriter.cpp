@@ -0,0 +1,57 @@
+#include "services/PackedDumpWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+// MARK: Begin()
+bool umd::PackedDumpWriter::Begin(SdBlockWriter& writer, uint32_t totalSize){
+    pWriter = &writer;
+    mFill = 0;
+    mHeader = {MAGIC, VERSION, 0, BLOCK_SIZE, totalSize, 0};
+    mPackedSize = sizeof(Header);
+
+    // the checksum is only known at the end, the header is rewritten then
+    return pWriter->Write(reinterpret_cast<const uint8_t *>(&mHeader), sizeof(Header));
+}
+
+// MARK: Write()
+bool umd::PackedDumpWriter::Write(const uint8_t *data, uint32_t size){
+    while(size != 0){
+        uint32_t count = std::min(size, BLOCK_SIZE - mFill);
+        std::memcpy(mBlock.data() + mFill, data, count);
+        mFill += count;
+        data += count;
+        size -= count;
+
+        if(mFill == BLOCK_SIZE && !PackBlock()){
+            return false;
+        }
+    }
+    return true;
+}
+
+// MARK: End()
+bool umd::PackedDumpWriter::End(){
+    return mFill == 0 || PackBlock();
+}
+
+// MARK: Finish()
+bool umd::PackedDumpWriter::Finish(File& file, uint32_t checksum){
+    mHeader.Checksum = checksum;
+    pWriter = nullptr;
+    return file.seek(0) && file.write(reinterpret_cast<const uint8_t *>(&mHeader), sizeof(Header)) == sizeof(Header);
+}
+
+// MARK: PackBlock()
+bool umd::PackedDumpWriter::PackBlock(){
+    // anything that doesn't shrink is stored, so a block never grows by more than its size field
+    uint32_t packed = mCodec.Compress(mBlock.data(), mFill, mPacked.data(), mFill - 1);
+    uint32_t entry = packed != 0 ? packed : (mFill | STORED_FLAG);
+    const uint8_t *payload = packed != 0 ? mPacked.data() : mBlock.data();
+    uint32_t payloadSize = packed != 0 ? packed : mFill;
+
+    bool result = pWriter->Write(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry)) && pWriter->Write(payload, payloadSize);
+    mPackedSize += sizeof(entry) + payloadSize;
+    mFill = 0;
+    return result;
+}
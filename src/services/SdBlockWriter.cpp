@@ -0,0 +1,199 @@
+#include "services/SdBlockWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+// MARK: Begin()
+bool umd::SdBlockWriter::Begin(File& file, uint32_t size, SdDmaSink* sink, uint32_t resumeOffset){
+    pFile = &file;
+    pSink = nullptr;
+    mSlot = 0;
+    mSlotsInFlight = 0;
+    mFill = 0;
+    mSize = size;
+    mWritten = 0;
+    mContiguous = false;
+    mError = false;
+
+    FIL* fil = file._fil;
+    if(fil == nullptr){
+        return false;
+    }
+
+    // stage whole clusters, the file starts on a cluster boundary so every chunk stays aligned
+    uint32_t sectorSize = FF_MAX_SS;
+#if FF_MAX_SS != FF_MIN_SS
+    sectorSize = fil->obj.fs->ssize;
+#endif
+    mChunkSize = std::min(MAX_CHUNK_SIZE, (uint32_t)fil->obj.fs->csize * sectorSize);
+
+    // the rest of a preallocated file goes through FatFs, whether it is contiguous isn't known anymore
+    if(resumeOffset != 0){
+        if(resumeOffset > size || (resumeOffset % MAX_CHUNK_SIZE) != 0 || f_lseek(fil, resumeOffset) != FR_OK){
+            return false;
+        }
+        mWritten = resumeOffset;
+        return true;
+    }
+
+    // start from an empty file, the allocation below needs it
+    if(f_lseek(fil, 0) != FR_OK || f_truncate(fil) != FR_OK){
+        return false;
+    }
+
+#if FF_USE_EXPAND
+    // allocate one contiguous run of clusters now
+    mContiguous = f_expand(fil, size, 1) == FR_OK;
+#endif
+    if(!mContiguous){
+        // at least allocate the whole cluster chain up front
+        if(f_lseek(fil, size) != FR_OK || f_lseek(fil, 0) != FR_OK){
+            return false;
+        }
+    }
+
+    // store the allocation and the size now, the data written later then survives a power loss
+    if(f_sync(fil) != FR_OK){
+        return false;
+    }
+
+    // a contiguous file is a plain run of sectors the DMA can write without FatFs
+    if(mContiguous && sink != nullptr && sectorSize == SdDmaSink::SECTOR_SIZE && mChunkSize >= DMA_SLOTS * sectorSize){
+        FATFS* fs = fil->obj.fs;
+        uint32_t firstSector = fs->database + (fil->obj.sclust - 2) * fs->csize;
+        if(sink->Begin(firstSector, (size + sectorSize - 1) / sectorSize)){
+            pSink = sink;
+        }
+    }
+    return true;
+}
+
+// MARK: Write()
+bool umd::SdBlockWriter::Write(const uint8_t *data, uint32_t size){
+    uint32_t slotSize = mChunkSize / DMA_SLOTS;
+
+    while(size != 0 && !mError){
+        if(pSink != nullptr){
+            // wait for the slot to come back from the DMA before refilling it
+            if(mFill == 0 && !ReclaimSlots(DMA_SLOTS - 1)){
+                return false;
+            }
+            uint32_t count = std::min(size, slotSize - mFill);
+            std::memcpy(Slot() + mFill, data, count);
+            mFill += count;
+            data += count;
+            size -= count;
+
+            if(mFill == slotSize){
+                SubmitSlot(slotSize);
+            }
+            continue;
+        }
+
+        uint32_t count = std::min(size, mChunkSize - mFill);
+        std::memcpy(mChunk + mFill, data, count);
+        mFill += count;
+        data += count;
+        size -= count;
+
+        if(mFill == mChunkSize){
+            Flush();
+        }
+    }
+
+    // keep the DMA queue moving while the caller works on the next data
+    if(pSink != nullptr){
+        ReclaimSlots(DMA_SLOTS);
+    }
+    return !mError;
+}
+
+// MARK: Sync()
+bool umd::SdBlockWriter::Sync(){
+    if(pSink != nullptr){
+        // the slots in flight are the only data not on the card yet
+        return ReclaimSlots(0);
+    }
+    if(!mError && mFill != 0){
+        Flush();
+    }
+    return !mError;
+}
+
+// MARK: Finish()
+bool umd::SdBlockWriter::Finish(){
+    if(pFile == nullptr){
+        return false;
+    }
+
+    if(pSink != nullptr){
+        // the whole sectors of the last slot go through the DMA, the tail of the last sector through FatFs
+        uint32_t tail = mFill % SdDmaSink::SECTOR_SIZE;
+        uint32_t sectors = mFill - tail;
+        const uint8_t *tailData = Slot() + sectors;
+        if(!mError && sectors != 0){
+            SubmitSlot(sectors);
+        }
+        mError = !pSink->Finish() || mError;
+        pSink = nullptr;
+        mSlotsInFlight = 0;
+
+        // the slots are free again once the DMA is done
+        std::memmove(mChunk, tailData, tail);
+        mFill = tail;
+        if(!mError && mFill != 0){
+            mError = f_lseek(pFile->_fil, mWritten) != FR_OK;
+        }
+    }
+
+    if(!mError && mFill != 0){
+        Flush();
+    }
+
+    // the preallocation may be larger than what was actually written
+    if(!mError && mWritten != mSize){
+        FIL* fil = pFile->_fil;
+        mError = f_lseek(fil, mWritten) != FR_OK || f_truncate(fil) != FR_OK;
+    }
+
+    pFile = nullptr;
+    return !mError;
+}
+
+// MARK: Flush()
+bool umd::SdBlockWriter::Flush(){
+    if(pFile->write(mChunk, mFill) != mFill){
+        mError = true;
+        return false;
+    }
+    mWritten += mFill;
+    mFill = 0;
+    return true;
+}
+
+// MARK: SubmitSlot()
+bool umd::SdBlockWriter::SubmitSlot(uint32_t size){
+    if(!pSink->Submit(Slot(), size)){
+        mError = true;
+        return false;
+    }
+    mWritten += size;
+    mFill = 0;
+    mSlotsInFlight++;
+    mSlot = (mSlot + 1) % DMA_SLOTS;
+    return true;
+}
+
+// MARK: ReclaimSlots()
+bool umd::SdBlockWriter::ReclaimSlots(uint8_t maxInFlight){
+    do{
+        if(pSink->Service() == SdDmaSink::Status::ERROR){
+            mError = true;
+            return false;
+        }
+        while(pSink->Reclaim() != nullptr){
+            mSlotsInFlight--;
+        }
+    }while(mSlotsInFlight > maxInFlight);
+    return true;
+}
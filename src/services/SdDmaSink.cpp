@@ -0,0 +1,161 @@
+#include "services/SdDmaSink.h"
+#include "services/SdTuner.h"
+
+// SD handle of the STM32SD library
+extern "C" SD_HandleTypeDef uSdHandle;
+
+namespace{
+    // sink receiving the completion interrupts
+    umd::SdDmaSink* pActiveSink = nullptr;
+}
+
+// MARK: Begin()
+bool umd::SdDmaSink::Begin(uint32_t firstSector, uint32_t sectorCount){
+    mSubmitted = mIssued = mCompleted = mReclaimed = 0;
+    mError = false;
+    mNextSector = firstSector;
+    mEndSector = firstSector + sectorCount;
+
+    // SDIO transmit is DMA2 stream 6 channel 4, the SDIO is the flow controller
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    mDmaTx.Instance = DMA2_Stream6;
+    mDmaTx.Init.Channel = DMA_CHANNEL_4;
+    mDmaTx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    mDmaTx.Init.PeriphInc = DMA_PINC_DISABLE;
+    mDmaTx.Init.MemInc = DMA_MINC_ENABLE;
+    mDmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    mDmaTx.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    mDmaTx.Init.Mode = DMA_PFCTRL;
+    mDmaTx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    mDmaTx.Init.FIFOMode = DMA_FIFOMODE_ENABLE;
+    mDmaTx.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+    mDmaTx.Init.MemBurst = DMA_MBURST_INC4;
+    mDmaTx.Init.PeriphBurst = DMA_PBURST_INC4;
+    if(HAL_DMA_Init(&mDmaTx) != HAL_OK){
+        return false;
+    }
+    __HAL_LINKDMA(&uSdHandle, hdmatx, mDmaTx);
+
+    pActiveSink = this;
+    mActive = true;
+    HAL_NVIC_SetPriority(SDIO_IRQn, IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(SDIO_IRQn);
+    HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, IRQ_PRIORITY + 1, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
+    return true;
+}
+
+// MARK: Submit()
+bool umd::SdDmaSink::Submit(const uint8_t *buffer, uint32_t size){
+    uint32_t sectors = size / SECTOR_SIZE;
+
+    if(mError || !mActive || IsFull() || sectors == 0 || (size % SECTOR_SIZE) != 0 || sectors > mEndSector - mNextSector){
+        return false;
+    }
+
+    Entry& entry = mQueue[mSubmitted % QUEUE_DEPTH];
+    entry.Buffer = buffer;
+    entry.Sector = mNextSector;
+    entry.Sectors = sectors;
+    mNextSector += sectors;
+    mSubmitted++;
+
+    Service();
+    return true;
+}
+
+// MARK: Service()
+umd::SdDmaSink::Status umd::SdDmaSink::Service(){
+    if(mError){
+        return Status::ERROR;
+    }
+
+    // a transfer is in flight
+    if(mIssued != mCompleted){
+        if(HAL_GetTick() - mIssueTicks > TRANSFER_TIMEOUT_MS){
+            mError = true;
+            return Status::ERROR;
+        }
+        return Status::BUSY;
+    }
+
+    if(mIssued == mSubmitted){
+        return Status::IDLE;
+    }
+
+    // the card must be done programming the previous blocks
+    if(uSdHandle.State != HAL_SD_STATE_READY || HAL_SD_GetCardState(&uSdHandle) != HAL_SD_CARD_TRANSFER){
+        if(mIssued != 0 && HAL_GetTick() - mIssueTicks > TRANSFER_TIMEOUT_MS){
+            mError = true;
+            return Status::ERROR;
+        }
+        return Status::BUSY;
+    }
+
+    Entry& entry = mQueue[mIssued % QUEUE_DEPTH];
+    mIssued++;
+    mIssueTicks = HAL_GetTick();
+    if(HAL_SD_WriteBlocks_DMA(&uSdHandle, const_cast<uint8_t *>(entry.Buffer), entry.Sector, entry.Sectors) != HAL_OK){
+        mError = true;
+        return Status::ERROR;
+    }
+    return Status::BUSY;
+}
+
+// MARK: Reclaim()
+const uint8_t* umd::SdDmaSink::Reclaim(){
+    if(mReclaimed == mCompleted){
+        return nullptr;
+    }
+    return mQueue[mReclaimed++ % QUEUE_DEPTH].Buffer;
+}
+
+// MARK: Finish()
+bool umd::SdDmaSink::Finish(){
+    if(!mActive){
+        return false;
+    }
+
+    while(Service() == Status::BUSY);
+
+    // leave the card ready for FatFs
+    uint32_t startTicks = HAL_GetTick();
+    while(!mError && HAL_SD_GetCardState(&uSdHandle) != HAL_SD_CARD_TRANSFER){
+        if(HAL_GetTick() - startTicks > TRANSFER_TIMEOUT_MS){
+            mError = true;
+        }
+    }
+
+    HAL_NVIC_DisableIRQ(DMA2_Stream6_IRQn);
+    HAL_NVIC_DisableIRQ(SDIO_IRQn);
+    HAL_DMA_DeInit(&mDmaTx);
+    uSdHandle.hdmatx = nullptr;
+    pActiveSink = nullptr;
+    mActive = false;
+    mReclaimed = mCompleted;
+    return !mError;
+}
+
+// MARK: Interrupts
+extern "C" void HAL_SD_TxCpltCallback(SD_HandleTypeDef *hsd){
+    if(pActiveSink != nullptr){
+        pActiveSink->OnTransferComplete();
+    }
+}
+
+extern "C" void HAL_SD_ErrorCallback(SD_HandleTypeDef *hsd){
+    umd::SdTuner::LatchErrors(hsd->ErrorCode);
+    if(pActiveSink != nullptr){
+        pActiveSink->OnTransferError();
+    }
+}
+
+extern "C" void SDIO_IRQHandler(void){
+    HAL_SD_IRQHandler(&uSdHandle);
+}
+
+extern "C" void DMA2_Stream6_IRQHandler(void){
+    if(uSdHandle.hdmatx != nullptr){
+        HAL_DMA_IRQHandler(uSdHandle.hdmatx);
+    }
+}
@@ -29,7 +29,8 @@ std::string umd::SdFileGameIdentifier::GetGameName(const std::string& gameId)
     std::array <char, 256> buffer;
     std::fill(buffer.begin(), buffer.end(), 0);
 
-    File file = SD.open(gameId.c_str());
+    std::string filePath = mBasePath + gameId + ".txt";
+    File file = SD.open(filePath.c_str());
 
     // fill the buffer with text from the file
     int size = std::min(file.available(), 255);
@@ -42,6 +43,15 @@ std::string umd::SdFileGameIdentifier::GetGameName(const std::string& gameId)
     return std::string(buffer.data());
 }
 
+/// @brief The block map of a game is a file named after the game ID like the name, with a .crc extension
+/// @param gameId 
+/// @return 
+std::string umd::SdFileGameIdentifier::GetBlockMapPath(const std::string& gameId)
+{
+    std::string filePath = mBasePath + gameId + ".crc";
+    return FileExists(filePath) ? filePath : std::string();
+}
+
 inline bool umd::SdFileGameIdentifier::FileExists(const std::string& filePath)
 {
     if(SD.exists(filePath.c_str()))
@@ -0,0 +1,226 @@
+#include "services/SdTuner.h"
+
+#include <cstdio>
+#include <vector>
+
+// SD handle of the STM32SD library
+extern "C" SD_HandleTypeDef uSdHandle;
+
+volatile uint32_t umd::SdTuner::sLinkErrors = 0;
+
+// FatFs goes through the blocking HAL transfers, the build wraps them with -Wl,--wrap so their errors are latched
+extern "C" HAL_StatusTypeDef __real_HAL_SD_ReadBlocks(SD_HandleTypeDef *hsd, uint8_t *pData, uint32_t blockAdd, uint32_t numberOfBlocks, uint32_t timeout);
+extern "C" HAL_StatusTypeDef __real_HAL_SD_WriteBlocks(SD_HandleTypeDef *hsd, uint8_t *pData, uint32_t blockAdd, uint32_t numberOfBlocks, uint32_t timeout);
+
+extern "C" HAL_StatusTypeDef __wrap_HAL_SD_ReadBlocks(SD_HandleTypeDef *hsd, uint8_t *pData, uint32_t blockAdd, uint32_t numberOfBlocks, uint32_t timeout){
+    HAL_StatusTypeDef status = __real_HAL_SD_ReadBlocks(hsd, pData, blockAdd, numberOfBlocks, timeout);
+    umd::SdTuner::LatchErrors(hsd->ErrorCode);
+    return status;
+}
+
+extern "C" HAL_StatusTypeDef __wrap_HAL_SD_WriteBlocks(SD_HandleTypeDef *hsd, uint8_t *pData, uint32_t blockAdd, uint32_t numberOfBlocks, uint32_t timeout){
+    HAL_StatusTypeDef status = __real_HAL_SD_WriteBlocks(hsd, pData, blockAdd, numberOfBlocks, timeout);
+    umd::SdTuner::LatchErrors(hsd->ErrorCode);
+    return status;
+}
+
+// MARK: Tune()
+umd::SdTuner::Setting umd::SdTuner::Tune(const std::string& scratchPath, const std::string& settingsPath){
+    mSettingsPath = settingsPath;
+
+    Setting stored;
+    if(Load(stored) && Apply(stored)){
+        mSetting = stored;
+        return mSetting;
+    }
+
+    // the bus width first at the safe clock, then the clock up to the first failure
+    Setting best = SAFE_SETTING;
+    Setting candidate = { SAFE_SETTING.ClockDiv, true };
+    if(!Apply(candidate) || !Test(scratchPath, 0)){
+        candidate.WideBus = false;
+    }
+
+    for(uint8_t i = 0; i < CLOCK_DIV_COUNT; i++){
+        candidate.ClockDiv = CLOCK_DIVS[i];
+        if(!Apply(candidate) || !Test(scratchPath, i)){
+            break;
+        }
+        best = candidate;
+    }
+
+    // back to a setting known to work before touching the FAT again
+    Apply(best);
+    SD.remove(scratchPath.c_str());
+    mSetting = best;
+    Save();
+
+    // the failures of the settings that were rejected don't count
+    sLinkErrors = 0;
+    return mSetting;
+}
+
+// MARK: CheckErrors()
+bool umd::SdTuner::CheckErrors(){
+    // read and clear without losing an error latched by an interrupt in between
+    __disable_irq();
+    uint32_t errors = sLinkErrors;
+    sLinkErrors = 0;
+    __enable_irq();
+
+    if(errors == 0){
+        return false;
+    }
+
+    // next slower clock, then the narrow bus
+    Setting slower = mSetting;
+    for(uint8_t i = CLOCK_DIV_COUNT - 1; i > 0; i--){
+        if(CLOCK_DIVS[i] == mSetting.ClockDiv){
+            slower.ClockDiv = CLOCK_DIVS[i - 1];
+            break;
+        }
+    }
+    if(slower.ClockDiv == mSetting.ClockDiv){
+        if(!mSetting.WideBus){
+            return false;
+        }
+        slower.WideBus = false;
+    }
+
+    if(!Apply(slower)){
+        return false;
+    }
+    mSetting = slower;
+    Save();
+    return true;
+}
+
+// MARK: Apply()
+bool umd::SdTuner::Apply(const Setting& setting){
+    // changing the width reprograms the clock from Init.ClockDiv
+    uSdHandle.Init.ClockDiv = setting.ClockDiv;
+    if(HAL_SD_ConfigWideBusOperation(&uSdHandle, setting.WideBus ? SDIO_BUS_WIDE_4B : SDIO_BUS_WIDE_1B) != HAL_OK){
+        return false;
+    }
+    SDIO->CLKCR = (SDIO->CLKCR & ~SDIO_CLKCR_CLKDIV) | setting.ClockDiv;
+    return true;
+}
+
+// MARK: Test()
+bool umd::SdTuner::Test(const std::string& scratchPath, uint8_t seed){
+    // a different pattern for every setting so stale data from a previous pass can't match
+    auto pattern = [seed](uint32_t pass, uint32_t i){ return (uint8_t)((i * 31) ^ (i >> 8) ^ (pass * 17) ^ (seed * 97)); };
+
+    sLinkErrors = 0;
+    SD.remove(scratchPath.c_str());
+    File file = SD.open(scratchPath.c_str(), FILE_WRITE);
+    if(!file){
+        return false;
+    }
+    bool result = true;
+    for(uint8_t pass = 0; pass < TEST_PASSES && result; pass++){
+        for(uint32_t i = 0; i < TEST_SIZE; i++){
+            mBuffer[i] = pattern(pass, i);
+        }
+        result = file.write(mBuffer, TEST_SIZE) == TEST_SIZE;
+    }
+    file.close();
+    if(!result){
+        return false;
+    }
+
+    file = SD.open(scratchPath.c_str(), FILE_READ);
+    if(!file){
+        return false;
+    }
+    for(uint8_t pass = 0; pass < TEST_PASSES && result; pass++){
+        result = file.read(mBuffer, TEST_SIZE) == (int)TEST_SIZE;
+        for(uint32_t i = 0; i < TEST_SIZE && result; i++){
+            result = mBuffer[i] == pattern(pass, i);
+        }
+    }
+    file.close();
+    return result && sLinkErrors == 0;
+}
+
+// MARK: Load()
+bool umd::SdTuner::Load(Setting& setting){
+    File file = SD.open(mSettingsPath.c_str(), FILE_READ);
+    if(!file){
+        return false;
+    }
+
+    // one card per line: CID, clock divider, bus width
+    std::string id = CardId();
+    std::string line;
+    bool found = false;
+    while(!found && ReadLine(file, line)){
+        unsigned int div, wide;
+        if(line.compare(0, id.size(), id) == 0 && sscanf(line.c_str() + id.size(), " %u %u", &div, &wide) == 2){
+            setting.ClockDiv = (uint8_t)div;
+            setting.WideBus = wide != 0;
+            found = true;
+        }
+    }
+    file.close();
+    return found;
+}
+
+// MARK: Save()
+void umd::SdTuner::Save(){
+    std::vector<std::string> lines;
+    std::string id = CardId();
+
+    // keep the other cards
+    File file = SD.open(mSettingsPath.c_str(), FILE_READ);
+    if(file){
+        std::string line;
+        while(ReadLine(file, line)){
+            if(!line.empty() && line.compare(0, id.size(), id) != 0){
+                lines.push_back(line);
+            }
+        }
+        file.close();
+    }
+
+    char entry[64];
+    snprintf(entry, sizeof(entry), "%s %u %u", id.c_str(), (unsigned int)mSetting.ClockDiv, mSetting.WideBus ? 1u : 0u);
+    lines.push_back(entry);
+
+    SD.remove(mSettingsPath.c_str());
+    file = SD.open(mSettingsPath.c_str(), FILE_WRITE);
+    if(!file){
+        return;
+    }
+    for(const auto& line : lines){
+        file.write(line.c_str());
+        file.write("\n");
+    }
+    file.close();
+}
+
+// MARK: CardId()
+std::string umd::SdTuner::CardId() const{
+    char id[33];
+    snprintf(id, sizeof(id), "%08lX%08lX%08lX%08lX", (unsigned long)uSdHandle.CID[0], (unsigned long)uSdHandle.CID[1],
+        (unsigned long)uSdHandle.CID[2], (unsigned long)uSdHandle.CID[3]);
+    return id;
+}
+
+// MARK: ReadLine()
+bool umd::SdTuner::ReadLine(File& file, std::string& line){
+    line.clear();
+    if(!file.available()){
+        return false;
+    }
+    while(file.available()){
+        int c = file.read();
+        if(c < 0 || c == '\n'){
+            break;
+        }
+        if(c != '\r'){
+            line += (char)c;
+        }
+    }
+    return true;
+}
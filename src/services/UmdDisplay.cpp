@@ -59,6 +59,15 @@ void UMDDisplay::UpdateProgressBar(uint32_t progress, uint32_t max, bool showMil
     // only show milliseconds if the progress bar is not showing the percentage
     mProgressBar.ShowMillis = showMillis;
     mProgressBar.ShowPercent = !showMillis;
+    mProgressBar.ShowRate = false;
+}
+
+void UMDDisplay::UpdateProgressBarRate(uint32_t progress, uint32_t max, uint32_t bytesPerSecond)
+{
+    UpdateProgressBar(progress, max);
+    mProgressBar.BytesPerSecond = bytesPerSecond;
+    mProgressBar.ShowPercent = false;
+    mProgressBar.ShowRate = true;
 }
 
 void UMDDisplay::SetProgressBarComplete(uint32_t millis)
@@ -69,6 +78,7 @@ void UMDDisplay::SetProgressBarComplete(uint32_t millis)
     mProgressBar.Percent = 1.0f;
     mProgressBar.ShowMillis = true;
     mProgressBar.ShowPercent = false;
+    mProgressBar.ShowRate = false;
 }
 
 // MARK: SetZoneVisibility()
@@ -502,6 +512,11 @@ void UMDDisplay::Redraw(void){
             mDisplay->setCursor(mProgressBar.Width + 8, linePosToCoordinate(currentLineOnDisplay));
             mDisplay->print(mProgressBar.Millis);
             mDisplay->print("ms");
+        }else if(mProgressBar.ShowRate)
+        {
+            mDisplay->setCursor(mProgressBar.Width + 8, linePosToCoordinate(currentLineOnDisplay));
+            mDisplay->print(mProgressBar.BytesPerSecond / 1024);
+            mDisplay->print("K/s");
         }
         currentLineOnDisplay++;
     }
@@ -0,0 +1,6 @@
+#pragma once
+
+// stand in for the HAL on the host, the tests provide the tick
+#include <cstdint>
+
+extern "C" uint32_t HAL_GetTick(void);
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "memory/IFlashBus.h"
+
+/// @brief Behavioural model of a word wide flash chip with the AMD command set: unlock cycles, word program, unlock
+/// bypass, write buffer programming, sector and chip erase. While an embedded algorithm runs, reads return the status
+/// word, DQ7 is the complement of the final data, DQ6 toggles on every read and DQ3 is set during an erase. The
+/// operation completes after BusyReads status reads, so a test controls how long each chip stays busy.
+class AmdFlashModel{
+public:
+    static constexpr uint16_t DQ7 = 0x0080;
+    static constexpr uint16_t DQ6 = 0x0040;
+    static constexpr uint16_t DQ5 = 0x0020;
+    static constexpr uint16_t DQ3 = 0x0008;
+    static constexpr uint16_t DQ1 = 0x0002;
+
+    std::vector<uint16_t> Memory;
+    uint32_t SectorWords;
+    // status reads an operation takes to complete
+    uint32_t BusyReads = 3;
+    // report a DQ5 timeout instead of completing
+    bool FailNext = false;
+    // DQ1 is only defined for write buffer programming, set it during the other operations like some parts do
+    bool SetUndefinedDQ1 = false;
+
+    // bookkeeping for the assertions
+    uint32_t WordsProgrammed = 0;
+    uint32_t SectorsErased = 0;
+    uint32_t ChipErases = 0;
+    uint32_t StatusReads = 0;
+    uint32_t BadSequences = 0;
+
+    AmdFlashModel(uint32_t words, uint32_t sectorWords) : Memory(words, 0xFFFF), SectorWords(sectorWords) {}
+
+    bool IsBusy() const { return mBusyLeft != 0; }
+
+    void Write(uint32_t address, uint16_t data){
+        if(mBusyLeft != 0){
+            // only the reset after a failure is accepted while busy
+            if(mFailed && data == 0x00F0){
+                Finish();
+                mState = State::READ;
+            }
+            return;
+        }
+
+        switch(mState){
+            case State::READ:
+                if(address == 0x555 && data == 0x00AA){
+                    mState = State::UNLOCK_1;
+                }else if(data != 0x00F0){
+                    BadSequences++;
+                }
+                break;
+            case State::UNLOCK_1:
+                mState = (address == 0x2AA && data == 0x0055) ? State::UNLOCK_2 : Bad();
+                break;
+            case State::UNLOCK_2:
+                Command(address, data);
+                break;
+            case State::PROGRAM:
+            case State::BYPASS_PROGRAM:
+                Program(address, data);
+                Start(Memory[address], false, false);
+                mState = mState == State::BYPASS_PROGRAM ? State::BYPASS : State::READ;
+                break;
+            case State::BYPASS:
+                if(data == 0x00A0){
+                    mState = State::BYPASS_PROGRAM;
+                }else if(data == 0x0090){
+                    mState = State::BYPASS_RESET;
+                }else{
+                    mState = Bad();
+                }
+                break;
+            case State::BYPASS_RESET:
+                mState = data == 0x0000 ? State::READ : Bad();
+                break;
+            case State::BUFFER_COUNT:
+                mBufferLeft = data + 1u;
+                mBuffer.clear();
+                mState = State::BUFFER_LOAD;
+                break;
+            case State::BUFFER_LOAD:
+                mBuffer.push_back({address, data});
+                if(--mBufferLeft == 0){
+                    mState = State::BUFFER_CONFIRM;
+                }
+                break;
+            case State::BUFFER_CONFIRM:
+                if(data != 0x0029 || mBuffer.empty()){
+                    mState = Bad();
+                    break;
+                }
+                for(const auto& entry : mBuffer){
+                    Program(entry.first, entry.second);
+                }
+                Start(Memory[mBuffer.back().first], false, true);
+                mState = State::READ;
+                break;
+            case State::ERASE_SETUP:
+                mState = (address == 0x555 && data == 0x00AA) ? State::ERASE_UNLOCK_1 : Bad();
+                break;
+            case State::ERASE_UNLOCK_1:
+                mState = (address == 0x2AA && data == 0x0055) ? State::ERASE_UNLOCK_2 : Bad();
+                break;
+            case State::ERASE_UNLOCK_2:
+                if(address == 0x555 && data == 0x0010){
+                    std::fill(Memory.begin(), Memory.end(), 0xFFFF);
+                    ChipErases++;
+                    Start(0xFFFF, true, false);
+                }else if(data == 0x0030){
+                    uint32_t start = (address / SectorWords) * SectorWords;
+                    std::fill(Memory.begin() + start, Memory.begin() + start + SectorWords, 0xFFFF);
+                    SectorsErased++;
+                    Start(0xFFFF, true, false);
+                }else{
+                    BadSequences++;
+                }
+                mState = State::READ;
+                break;
+        }
+    }
+
+    uint16_t Read(uint32_t address){
+        if(mBusyLeft == 0){
+            return Memory[address];
+        }
+
+        StatusReads++;
+        mToggle ^= DQ6;
+        uint16_t status = (uint16_t)((~mFinal & DQ7) | mToggle | (mErasing ? DQ3 : 0) | (SetUndefinedDQ1 && !mBuffered ? DQ1 : 0));
+        if(mFailed){
+            return status | DQ5;
+        }
+        if(--mBusyLeft == 0){
+            Finish();
+        }
+        return status;
+    }
+
+private:
+    enum class State : uint8_t{
+        READ,
+        UNLOCK_1,
+        UNLOCK_2,
+        PROGRAM,
+        BYPASS,
+        BYPASS_PROGRAM,
+        BYPASS_RESET,
+        BUFFER_COUNT,
+        BUFFER_LOAD,
+        BUFFER_CONFIRM,
+        ERASE_SETUP,
+        ERASE_UNLOCK_1,
+        ERASE_UNLOCK_2
+    };
+
+    State mState = State::READ;
+    uint32_t mBusyLeft = 0;
+    uint16_t mFinal = 0;
+    uint16_t mToggle = 0;
+    bool mErasing = false;
+    bool mBuffered = false;
+    bool mFailed = false;
+    uint32_t mBufferLeft = 0;
+    std::vector<std::pair<uint32_t, uint16_t>> mBuffer;
+
+    void Command(uint32_t address, uint16_t data){
+        mState = State::READ;
+        if(data == 0x0025){
+            mState = State::BUFFER_COUNT;
+            return;
+        }
+        if(address != 0x555){
+            BadSequences++;
+            return;
+        }
+        switch(data){
+            case 0x00A0: mState = State::PROGRAM; break;
+            case 0x0020: mState = State::BYPASS; break;
+            case 0x0080: mState = State::ERASE_SETUP; break;
+            case 0x00F0: break;
+            default: BadSequences++; break;
+        }
+    }
+
+    void Program(uint32_t address, uint16_t data){
+        // programming can only clear bits
+        Memory[address] &= data;
+        WordsProgrammed++;
+    }
+
+    void Start(uint16_t final, bool erasing, bool buffered){
+        mFinal = final;
+        mErasing = erasing;
+        mBuffered = buffered;
+        mBusyLeft = BusyReads;
+        mFailed = FailNext;
+        FailNext = false;
+    }
+
+    void Finish(){
+        mBusyLeft = 0;
+        mErasing = false;
+        mFailed = false;
+    }
+
+    State Bad(){
+        BadSequences++;
+        return State::READ;
+    }
+};
+
+/// @brief Board of identical chips decoded by address, chip n answers from n times the chip size
+class MultiChipBus : public cartridges::IFlashBus{
+public:
+    std::vector<AmdFlashModel> Chips;
+
+    MultiChipBus(uint8_t chips, uint32_t chipWords, uint32_t sectorWords)
+        : Chips(chips, AmdFlashModel(chipWords, sectorWords)), mChipWords(chipWords) {}
+
+    virtual void FlashWrite(uint32_t wordAddress, uint16_t data) override {
+        Chips[wordAddress / mChipWords].Write(wordAddress % mChipWords, data);
+    }
+
+    virtual uint16_t FlashRead(uint32_t wordAddress) override {
+        return Chips[wordAddress / mChipWords].Read(wordAddress % mChipWords);
+    }
+
+private:
+    uint32_t mChipWords;
+};
@@ -0,0 +1,294 @@
+#include <unity.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "memory/FlashInterleaver.h"
+#include "AmdFlashModel.h"
+
+using cartridges::FlashChip;
+using cartridges::FlashInfo;
+using cartridges::FlashInterleaver;
+using cartridges::FlashProgrammer;
+
+// the timeouts are never reached, the tick only moves when a test moves it
+static uint32_t Ticks = 0;
+extern "C" uint32_t HAL_GetTick(void) { return Ticks; }
+
+static constexpr uint32_t CHIP_SIZE = 0x10000;
+static constexpr uint32_t CHIP_WORDS = CHIP_SIZE >> 1;
+static constexpr uint32_t SECTOR_SIZE = 0x2000;
+static constexpr uint32_t SECTOR_WORDS = SECTOR_SIZE >> 1;
+
+// small uniform chips, one programmed a word at a time in unlock bypass and one with a 32 byte write buffer
+static constexpr FlashChip BYPASS_CHIP = { 0x01, 0x1111, "BYPASS", CHIP_SIZE, 0, true, false, 1, { { CHIP_SIZE / SECTOR_SIZE, SECTOR_SIZE } },
+    { 10, 0, 100, 1000 }, { 1000, 0, 1000, 10000 } };
+static constexpr FlashChip BUFFER_CHIP = { 0x01, 0x2222, "BUFFER", CHIP_SIZE, 32, true, false, 1, { { CHIP_SIZE / SECTOR_SIZE, SECTOR_SIZE } },
+    { 10, 40, 100, 1000 }, { 1000, 1000, 1000, 10000 } };
+
+static FlashInfo BoardInfo(const FlashChip& chip, uint8_t chips){
+    FlashInfo info(chip.Manufacturer, chip.Device, chip);
+    info.SetChipCount(chips);
+    return info;
+}
+
+/// @brief data in file order, word i of the pattern reads back as seed + i on the bus
+static std::vector<uint8_t> Pattern(uint32_t words, uint16_t seed){
+    std::vector<uint8_t> data(words << 1);
+    for(uint32_t i = 0; i < words; i++){
+        uint16_t word = (uint16_t)(seed + i);
+        data[i << 1] = (uint8_t)(word >> 8);
+        data[(i << 1) + 1] = (uint8_t)word;
+    }
+    return data;
+}
+
+static FlashProgrammer::Status RunToCompletion(FlashInterleaver& flash){
+    FlashProgrammer::Status status = flash.GetStatus();
+    for(uint32_t i = 0; i < 1000000 && status == FlashProgrammer::Status::BUSY; i++){
+        status = flash.Service();
+    }
+    return status;
+}
+
+static void AssertWords(const AmdFlashModel& chip, uint32_t address, uint32_t words, uint16_t seed){
+    for(uint32_t i = 0; i < words; i++){
+        TEST_ASSERT_EQUAL_HEX16((uint16_t)(seed + i), chip.Memory[address + i]);
+    }
+}
+
+static void AssertBlank(const AmdFlashModel& chip, uint32_t address, uint32_t words){
+    for(uint32_t i = 0; i < words; i++){
+        TEST_ASSERT_EQUAL_HEX16(0xFFFF, chip.Memory[address + i]);
+    }
+}
+
+void setUp(){
+    Ticks = 0;
+}
+
+void tearDown(){}
+
+// MARK: placement
+void test_two_chips_program_side_by_side(){
+    MultiChipBus bus(2, CHIP_WORDS, SECTOR_WORDS);
+    FlashInterleaver flash(bus);
+    flash.Configure(BoardInfo(BYPASS_CHIP, 2));
+    TEST_ASSERT_EQUAL_UINT8(2, flash.GetChipCount());
+    TEST_ASSERT_EQUAL_UINT32(CHIP_WORDS, flash.GetChipWords());
+
+    std::vector<uint8_t> first = Pattern(64, 0x1000);
+    std::vector<uint8_t> second = Pattern(64, 0x2000);
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::BUSY, (int)flash.BeginProgram(0x100, first.data(), 64));
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::BUSY, (int)flash.BeginProgram(CHIP_WORDS + 0x100, second.data(), 64));
+
+    // both chips have an operation in flight at once
+    TEST_ASSERT_TRUE(bus.Chips[0].IsBusy());
+    TEST_ASSERT_TRUE(bus.Chips[1].IsBusy());
+
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)RunToCompletion(flash));
+
+    // each chip got its own range at its own offset, nothing spilled over
+    AssertWords(bus.Chips[0], 0x100, 64, 0x1000);
+    AssertWords(bus.Chips[1], 0x100, 64, 0x2000);
+    AssertBlank(bus.Chips[0], 0, 0x100);
+    AssertBlank(bus.Chips[1], 0, 0x100);
+    AssertBlank(bus.Chips[0], 0x140, CHIP_WORDS - 0x140);
+    AssertBlank(bus.Chips[1], 0x140, CHIP_WORDS - 0x140);
+    TEST_ASSERT_EQUAL_UINT32(0, bus.Chips[0].BadSequences);
+    TEST_ASSERT_EQUAL_UINT32(0, bus.Chips[1].BadSequences);
+    TEST_ASSERT_EQUAL_UINT32(128, flash.GetStats().WordsProgrammed);
+}
+
+void test_blank_words_are_skipped(){
+    MultiChipBus bus(2, CHIP_WORDS, SECTOR_WORDS);
+    FlashInterleaver flash(bus);
+    flash.Configure(BoardInfo(BYPASS_CHIP, 2));
+
+    std::vector<uint8_t> data = Pattern(16, 0x3000);
+    for(uint32_t i = 4; i < 12; i++){
+        data[i << 1] = 0xFF;
+        data[(i << 1) + 1] = 0xFF;
+    }
+    flash.BeginProgram(CHIP_WORDS, data.data(), 16);
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)RunToCompletion(flash));
+
+    TEST_ASSERT_EQUAL_UINT32(8, bus.Chips[1].WordsProgrammed);
+    TEST_ASSERT_EQUAL_UINT32(0, bus.Chips[0].WordsProgrammed);
+    TEST_ASSERT_EQUAL_UINT32(8, flash.GetStats().WordsSkipped);
+    AssertWords(bus.Chips[1], 0, 4, 0x3000);
+    AssertBlank(bus.Chips[1], 4, 8);
+    AssertWords(bus.Chips[1], 12, 4, 0x300C);
+}
+
+void test_four_chips_write_buffer(){
+    MultiChipBus bus(4, CHIP_WORDS, SECTOR_WORDS);
+    FlashInterleaver flash(bus);
+    flash.Configure(BoardInfo(BUFFER_CHIP, 4));
+    TEST_ASSERT_EQUAL_UINT8(4, flash.GetChipCount());
+
+    // an unaligned start so the first buffer load stops at the page boundary
+    std::array<std::vector<uint8_t>, 4> data;
+    for(uint8_t c = 0; c < 4; c++){
+        data[c] = Pattern(100, (uint16_t)(0x4000 + (c << 8)));
+        TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::BUSY, (int)flash.BeginProgram(c * CHIP_WORDS + 0x205, data[c].data(), 100));
+    }
+    for(uint8_t c = 0; c < 4; c++){
+        TEST_ASSERT_TRUE(bus.Chips[c].IsBusy());
+    }
+
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)RunToCompletion(flash));
+
+    for(uint8_t c = 0; c < 4; c++){
+        AssertWords(bus.Chips[c], 0x205, 100, (uint16_t)(0x4000 + (c << 8)));
+        AssertBlank(bus.Chips[c], 0, 0x205);
+        AssertBlank(bus.Chips[c], 0x205 + 100, CHIP_WORDS - 0x205 - 100);
+        TEST_ASSERT_EQUAL_UINT32(100, bus.Chips[c].WordsProgrammed);
+        TEST_ASSERT_EQUAL_UINT32(0, bus.Chips[c].BadSequences);
+        TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)flash.GetChipStatus(c));
+    }
+}
+
+// MARK: status polling
+void test_each_chip_is_polled_on_its_own(){
+    MultiChipBus bus(2, CHIP_WORDS, SECTOR_WORDS);
+    FlashInterleaver flash(bus);
+    flash.Configure(BoardInfo(BYPASS_CHIP, 2));
+
+    // the second chip is much slower
+    bus.Chips[0].BusyReads = 2;
+    bus.Chips[1].BusyReads = 50;
+
+    std::vector<uint8_t> first = Pattern(1, 0x5000);
+    std::vector<uint8_t> second = Pattern(1, 0x6000);
+    flash.BeginProgram(0x10, first.data(), 1);
+    flash.BeginProgram(CHIP_WORDS + 0x10, second.data(), 1);
+
+    for(uint8_t i = 0; i < 4; i++){
+        flash.Service();
+    }
+
+    // the fast chip is done while the slow one still reports DQ7 inverted and DQ6 toggling
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)flash.GetChipStatus(0));
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::BUSY, (int)flash.GetChipStatus(1));
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::BUSY, (int)flash.GetStatus());
+    TEST_ASSERT_TRUE(flash.IsToggling());
+
+    // the idle chip takes more work while the other one is still busy
+    std::vector<uint8_t> more = Pattern(8, 0x7000);
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::BUSY, (int)flash.BeginProgram(0x20, more.data(), 8));
+    TEST_ASSERT_TRUE(bus.Chips[1].IsBusy());
+
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)RunToCompletion(flash));
+    TEST_ASSERT_FALSE(flash.IsToggling());
+    AssertWords(bus.Chips[0], 0x10, 1, 0x5000);
+    AssertWords(bus.Chips[0], 0x20, 8, 0x7000);
+    AssertWords(bus.Chips[1], 0x10, 1, 0x6000);
+
+    // the slow chip was polled for as long as it was busy, not longer
+    TEST_ASSERT_EQUAL_UINT32(50, bus.Chips[1].StatusReads);
+}
+
+void test_failed_chip_is_reported(){
+    MultiChipBus bus(4, CHIP_WORDS, SECTOR_WORDS);
+    FlashInterleaver flash(bus);
+    flash.Configure(BoardInfo(BUFFER_CHIP, 4));
+
+    // DQ5 on the third chip
+    bus.Chips[2].FailNext = true;
+
+    std::vector<uint8_t> data = Pattern(16, 0x8000);
+    for(uint8_t c = 0; c < 4; c++){
+        flash.BeginProgram(c * CHIP_WORDS, data.data(), 16);
+    }
+
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::ERROR_ABORT, (int)RunToCompletion(flash));
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::ERROR_ABORT, (int)flash.GetChipStatus(2));
+
+    // the other chips finish their part
+    for(uint8_t i = 0; i < 10; i++){
+        flash.Service();
+    }
+    for(uint8_t c = 0; c < 4; c++){
+        if(c != 2){
+            TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)flash.GetChipStatus(c));
+            AssertWords(bus.Chips[c], 0, 16, 0x8000);
+        }
+    }
+
+    // the abort reset brought the failed chip back to read mode
+    TEST_ASSERT_FALSE(bus.Chips[2].IsBusy());
+}
+
+// MARK: erase
+void test_erase_range_across_chips(){
+    MultiChipBus bus(2, CHIP_WORDS, SECTOR_WORDS);
+    FlashInterleaver flash(bus);
+    flash.Configure(BoardInfo(BYPASS_CHIP, 2));
+
+    for(AmdFlashModel& chip : bus.Chips){
+        std::fill(chip.Memory.begin(), chip.Memory.end(), 0x0000);
+    }
+
+    // the last sector of the first chip and the first two of the second
+    uint32_t start = CHIP_WORDS - SECTOR_WORDS;
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::BUSY, (int)flash.BeginEraseRange(start, 3 * SECTOR_WORDS));
+    TEST_ASSERT_TRUE(bus.Chips[0].IsBusy());
+    TEST_ASSERT_TRUE(bus.Chips[1].IsBusy());
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)RunToCompletion(flash));
+
+    TEST_ASSERT_EQUAL_UINT32(1, bus.Chips[0].SectorsErased);
+    TEST_ASSERT_EQUAL_UINT32(2, bus.Chips[1].SectorsErased);
+    TEST_ASSERT_EQUAL_HEX16(0x0000, bus.Chips[0].Memory[start - 1]);
+    AssertBlank(bus.Chips[0], start, SECTOR_WORDS);
+    AssertBlank(bus.Chips[1], 0, 2 * SECTOR_WORDS);
+    TEST_ASSERT_EQUAL_HEX16(0x0000, bus.Chips[1].Memory[2 * SECTOR_WORDS]);
+}
+
+void test_dq1_is_ignored_outside_write_buffers(){
+    MultiChipBus bus(2, CHIP_WORDS, SECTOR_WORDS);
+    FlashInterleaver flash(bus);
+    flash.Configure(BoardInfo(BYPASS_CHIP, 2));
+    for(AmdFlashModel& chip : bus.Chips){
+        chip.SetUndefinedDQ1 = true;
+    }
+
+    flash.BeginEraseRange(0, SECTOR_WORDS);
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)RunToCompletion(flash));
+
+    std::vector<uint8_t> data = Pattern(16, 0x9000);
+    flash.BeginProgram(CHIP_WORDS, data.data(), 16);
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)RunToCompletion(flash));
+    AssertWords(bus.Chips[1], 0, 16, 0x9000);
+}
+
+void test_chip_erase_runs_on_every_chip(){
+    MultiChipBus bus(4, CHIP_WORDS, SECTOR_WORDS);
+    FlashInterleaver flash(bus);
+    flash.Configure(BoardInfo(BUFFER_CHIP, 4));
+
+    for(AmdFlashModel& chip : bus.Chips){
+        std::fill(chip.Memory.begin(), chip.Memory.end(), 0x1234);
+    }
+
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::BUSY, (int)flash.BeginChipErase());
+    TEST_ASSERT_EQUAL((int)FlashProgrammer::Status::IDLE, (int)RunToCompletion(flash));
+    for(AmdFlashModel& chip : bus.Chips){
+        TEST_ASSERT_EQUAL_UINT32(1, chip.ChipErases);
+        AssertBlank(chip, 0, CHIP_WORDS);
+    }
+}
+
+int main(int argc, char **argv){
+    UNITY_BEGIN();
+    RUN_TEST(test_two_chips_program_side_by_side);
+    RUN_TEST(test_blank_words_are_skipped);
+    RUN_TEST(test_four_chips_write_buffer);
+    RUN_TEST(test_each_chip_is_polled_on_its_own);
+    RUN_TEST(test_failed_chip_is_reported);
+    RUN_TEST(test_erase_range_across_chips);
+    RUN_TEST(test_dq1_is_ignored_outside_write_buffers);
+    RUN_TEST(test_chip_erase_runs_on_every_chip);
+    return UNITY_END();
+}